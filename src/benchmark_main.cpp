@@ -0,0 +1,105 @@
+#include "juce_build.cpp"
+#include "simulated_instance.hpp"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <numeric>
+#include <random>
+
+// NOTE(luca): replays edit workloads against a headless StateManager and prints the latency of every
+// operation. The track is laid out by populateTrack.
+//
+// Usage: Automate-Benchmark [points] [parameters] [iterations]
+// Without arguments it runs 10k and 100k points against 1k and 10k parameters.
+
+namespace atmt {
+
+struct Benchmark {
+  using clock = std::chrono::steady_clock;
+
+  Benchmark(u32 points, u32 parameters, u32 iterations) : numPoints(points), numParameters(parameters), numIterations(iterations) {}
+
+  void run() {
+    plugin = std::make_unique<Plugin>();
+    auto& m = plugin->manager;
+
+    m.installPlugin(std::make_unique<SimulatedInstance>(numParameters), 48000, 512);
+
+    // NOTE(luca): keep the autosave thread out of the numbers
+    m.journal.stop();
+
+    populate();
+
+    std::cout << "\n" << numPoints << " points, " << numParameters << " parameters, " << numIterations << " iterations\n";
+    std::cout << "operation              mean us    p50 us    p99 us    max us\n";
+
+    measure("addClip", [&] (u32) { m.addClip(randomX(), f32(rng() % 2), 0.5f); });
+    measure("moveClip", [&] (u32) { u32 id = randomIndex(m.clips.size()); m.moveClip(id, randomX(), m.clips[id].y, randomUnit()); });
+    measure("removeClip", [&] (u32) { if (m.clips.size() > 2) m.removeClip(randomIndex(m.clips.size())); });
+    measure("addPath", [&] (u32) { m.addPath(randomX(), randomUnit(), 0.5f); });
+    measure("movePath", [&] (u32) { if (!m.paths.empty()) m.movePath(randomIndex(m.paths.size()), randomX(), randomUnit(), randomUnit()); });
+    measure("removePath", [&] (u32) { if (m.paths.size() > 1) m.removePath(randomIndex(m.paths.size())); });
+    measure("bendAutomation", [&] (u32) { m.bendAutomation(randomX(), 0.01f); });
+    measure("dragAutomationSection", [&] (u32) { m.dragAutomationSection(randomX(), 0.01f); });
+    measure("removeSelection", [&] (u32) { f32 x = randomX(); m.setSelection(x, x + 4); m.removeSelection(); });
+    measure("doZoom", [&] (u32 i) { m.doZoom(i % 2 ? -1.f : 1.f, kWidth / 2); });
+
+    plugin.reset();
+  }
+
+  void populate() {
+    populateTrack(plugin->manager, numPoints, rng);
+    length = f32(numPoints);
+  }
+
+  template <typename F>
+  void measure(const char* name, F&& op) {
+    std::vector<f64> times(numIterations);
+
+    for (u32 i = 0; i < numIterations; ++i) {
+      auto start = clock::now();
+      op(i);
+      times[i] = std::chrono::duration<f64, std::micro>(clock::now() - start).count();
+    }
+
+    std::sort(times.begin(), times.end());
+
+    f64 mean = std::accumulate(times.begin(), times.end(), 0.0) / f64(times.size());
+    auto at = [&] (f64 q) { return times[std::min(size_t(q * f64(times.size())), times.size() - 1)]; };
+
+    std::printf("%-22s %9.1f %9.1f %9.1f %9.1f\n", name, mean, at(0.5), at(0.99), times.back());
+  }
+
+  f32 randomX() { return std::uniform_real_distribution<f32>(0, length)(rng); }
+  f32 randomUnit() { return std::uniform_real_distribution<f32>(0, 1)(rng); }
+  u32 randomIndex(size_t size) { return u32(rng() % size); }
+
+  u32 numPoints = 0;
+  u32 numParameters = 0;
+  u32 numIterations = 0;
+  f32 length = 0;
+
+  std::mt19937 rng { 1 };
+  std::unique_ptr<Plugin> plugin;
+};
+
+} // namespace atmt
+
+int main(int argc, char* argv[]) {
+  juce::ScopedJuceInitialiser_GUI init;
+
+  u32 iterations = argc > 3 ? u32(std::atoi(argv[3])) : 100;
+
+  if (argc > 2) {
+    atmt::Benchmark(u32(std::atoi(argv[1])), u32(std::atoi(argv[2])), iterations).run();
+    return 0;
+  }
+
+  for (u32 points : { 10000u, 100000u }) {
+    for (u32 parameters : { 1000u, 10000u }) {
+      atmt::Benchmark(points, parameters, iterations).run();
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,158 @@
+#include "document.hpp"
+#include "utils.hpp"
+#include <assert.h>
+
+namespace atmt {
+
+template <typename I, typename T>
+static bool eraseSparse(std::vector<I>& indices, std::vector<T>& values, u32 i) {
+  auto it = std::lower_bound(indices.begin(), indices.end(), i);
+
+  if (it != indices.end() && *it == i) {
+    values.erase(values.begin() + (it - indices.begin()));
+    indices.erase(it);
+    return true;
+  }
+
+  return false;
+}
+
+template <typename I, typename T>
+static void insertSparse(std::vector<I>& indices, std::vector<T>& values, u32 i, T v) {
+  auto it = std::lower_bound(indices.begin(), indices.end(), i);
+  auto n = it - indices.begin();
+
+  if (it != indices.end() && *it == i) {
+    values[u32(n)] = v;
+  } else {
+    indices.insert(it, I(i));
+    values.insert(values.begin() + n, v);
+  }
+}
+
+u32 Clip::getNumParameters() const {
+  return base ? u32(base->size()) : 0;
+}
+
+f32 Clip::getParameter(u32 i) const {
+  assert(base && i < base->size());
+
+  auto it = std::lower_bound(indices.begin(), indices.end(), i);
+
+  if (it != indices.end() && *it == i) {
+    return values[u32(it - indices.begin())];
+  }
+
+  if (i <= maxQuantizedIndex) {
+    auto q = std::lower_bound(quantizedIndices.begin(), quantizedIndices.end(), i);
+
+    if (q != quantizedIndices.end() && *q == i) {
+      return dequantize(quantizedValues[u32(q - quantizedIndices.begin())]);
+    }
+  }
+
+  return (*base)[i];
+}
+
+void Clip::setParameter(u32 i, f32 v, bool quantized) {
+  assert(base && i < base->size());
+  assert(isNormalised(v));
+
+  if (quantized) {
+    assert(i <= maxQuantizedIndex);
+    eraseSparse(indices, values, i);
+
+    if (quantize(v) == quantize((*base)[i])) {
+      eraseSparse(quantizedIndices, quantizedValues, i);
+    } else {
+      insertSparse(quantizedIndices, quantizedValues, i, quantize(v));
+    }
+  } else {
+    eraseSparse(quantizedIndices, quantizedValues, i);
+
+    if (!neqf32(v, (*base)[i])) {
+      eraseSparse(indices, values, i);
+    } else {
+      insertSparse(indices, values, i, v);
+    }
+  }
+}
+
+void Clip::setParameters(std::shared_ptr<const std::vector<f32>> b, const f32* dense, const std::vector<bool>& quantized) {
+  assert(b && quantized.size() == b->size());
+
+  base = std::move(b);
+  indices.clear();
+  values.clear();
+  quantizedIndices.clear();
+  quantizedValues.clear();
+
+  for (u32 i = 0; i < base->size(); ++i) {
+    assert(isNormalised(dense[i]));
+
+    if (quantized[i]) {
+      assert(i <= maxQuantizedIndex);
+
+      if (quantize(dense[i]) != quantize((*base)[i])) {
+        quantizedIndices.push_back(u16(i));
+        quantizedValues.push_back(quantize(dense[i]));
+      }
+    } else if (neqf32(dense[i], (*base)[i])) {
+      indices.push_back(i);
+      values.push_back(dense[i]);
+    }
+  }
+}
+
+void Clip::expand(f32* dense) const {
+  assert(base);
+
+  std::copy(base->begin(), base->end(), dense);
+
+  for (u32 i = 0; i < indices.size(); ++i) {
+    dense[indices[i]] = values[i];
+  }
+
+  for (u32 i = 0; i < quantizedIndices.size(); ++i) {
+    dense[quantizedIndices[i]] = dequantize(quantizedValues[i]);
+  }
+}
+
+size_t Clip::getMemoryUsage() const {
+  return sizeof(Clip)
+       + indices.capacity() * sizeof(u32)
+       + values.capacity() * sizeof(f32)
+       + (quantizedIndices.capacity() + quantizedValues.capacity()) * sizeof(u16);
+}
+
+bool Clip::findDifferences(const Clip& a, const Clip& b, std::vector<u32>& changed) {
+  u32 numParameters = a.getNumParameters();
+  assert(numParameters == b.getNumParameters());
+
+  changed.clear();
+
+  if (a.base != b.base) {
+    for (u32 i = 0; i < numParameters; ++i) {
+      if (neqf32(a.getParameter(i), b.getParameter(i))) {
+        changed.push_back(i);
+      }
+    }
+
+    return !changed.empty();
+  }
+
+  // NOTE(luca): both clips agree with the base everywhere except at their own indices
+  changed.reserve(a.indices.size() + a.quantizedIndices.size() + b.indices.size() + b.quantizedIndices.size());
+  changed.insert(changed.end(), a.indices.begin(), a.indices.end());
+  changed.insert(changed.end(), a.quantizedIndices.begin(), a.quantizedIndices.end());
+  changed.insert(changed.end(), b.indices.begin(), b.indices.end());
+  changed.insert(changed.end(), b.quantizedIndices.begin(), b.quantizedIndices.end());
+
+  std::sort(changed.begin(), changed.end());
+  changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+  changed.erase(std::remove_if(changed.begin(), changed.end(), [&] (u32 i) { return !neqf32(a.getParameter(i), b.getParameter(i)); }), changed.end());
+
+  return !changed.empty();
+}
+
+} // namespace atmt
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "types.hpp"
+#include "persistent_vector.hpp"
+#include <cmath>
+#include <memory>
+#include <vector>
+
+namespace atmt {
+
+struct Path {
+  f32 x = 0;
+  f32 y = 0;
+  f32 c = 0.5;
+};
+
+// NOTE(luca): a clip only stores the parameters that differ from the base snapshot shared by every clip,
+// indices are kept sorted. Continuous parameters can be stored as 16-bit fixed point with a 16-bit index,
+// half the size of a float delta. Stepped ones and anything past index 65535 keep their exact value.
+struct Clip {
+  f32 x = 0;
+  f32 y = 0;
+  f32 c = 0.5;
+  // NOTE(luca): position on the xy pad, negative until the clip has been placed
+  f32 padX = -1;
+  f32 padY = -1;
+  std::shared_ptr<const std::vector<f32>> base;
+  std::vector<u32> indices;
+  std::vector<f32> values;
+  std::vector<u16> quantizedIndices;
+  std::vector<u16> quantizedValues;
+
+  u32 getNumParameters() const;
+  f32 getParameter(u32) const;
+  void setParameter(u32, f32, bool);
+  void setParameters(std::shared_ptr<const std::vector<f32>>, const f32*, const std::vector<bool>&);
+  void expand(f32*) const;
+  size_t getMemoryUsage() const;
+
+  static bool findDifferences(const Clip&, const Clip&, std::vector<u32>&);
+
+  static constexpr u32 maxQuantizedIndex = 0xffff;
+
+  static u16 quantize(f32 v)   { return u16(std::lround(v * 65535.f)); }
+  static f32 dequantize(u16 v) { return f32(v) * (1.f / 65535.f); }
+};
+
+// NOTE(luca): one version of the editable state, kept on the undo and redo stacks
+struct Document {
+  PersistentVector<Clip> clips;
+  PersistentVector<Path> paths;
+  std::shared_ptr<const std::vector<bool>> active;
+  // NOTE(luca): the clips are encoded according to it, so it has to be undone together with them
+  bool quantizeClips = false;
+};
+
+} // namespace atmt
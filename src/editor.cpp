@@ -93,7 +93,8 @@ void Dial::mouseUp(const juce::MouseEvent& e) {
 }
 
 void InfoView::paint(juce::Graphics& g) {
-  auto r = getLocalBounds().withSizeKeepingCentre(i32(kWidth * 0.6f), numCommands * commandHeight);
+  auto r = getLocalBounds().withSizeKeepingCentre(i32(kWidth * 0.6f), (numCommands + 2) * commandHeight);
+  auto footer = r.removeFromBottom(commandHeight);
   auto left = r.removeFromLeft(r.getWidth() / 2);
   auto right = r;
 
@@ -105,6 +106,9 @@ void InfoView::paint(juce::Graphics& g) {
     g.drawText(commands[i].name, left.removeFromTop(commandHeight), juce::Justification::left);
     g.drawText(commands[i].binding, right.removeFromTop(commandHeight), juce::Justification::right);
   }
+
+  g.setColour(Colours::frenchGray);
+  g.drawText(memoryUsage, footer, juce::Justification::left);
 }
 
 void InfoView::mouseDown(const juce::MouseEvent&) {
@@ -124,6 +128,14 @@ void PathView::paint(juce::Graphics& g) {
   g.fillEllipse(getLocalBounds().toFloat().withSizeKeepingCentre(size / 2, size / 2));
 }
 
+void PathView::mouseDown(const juce::MouseEvent&) {
+  beginGesture();
+}
+
+void PathView::mouseUp(const juce::MouseEvent&) {
+  endGesture();
+}
+
 void PathView::mouseDrag(const juce::MouseEvent& e) {
   auto parent = getParentComponent();
   assert(parent);
@@ -132,6 +144,8 @@ void PathView::mouseDrag(const juce::MouseEvent& e) {
 }
 
 void PathView::mouseDoubleClick(const juce::MouseEvent&) {
+  // NOTE(luca): removing the view can delete it before its mouseUp, the gesture has to end here
+  endGesture();
   remove(id);
 }
 
@@ -158,6 +172,7 @@ void ClipView::mouseDown(const juce::MouseEvent& e) {
   mouseDownOffset = getWidth() / 2 - e.position.x;
 
   select(i32(id));
+  beginGesture();
 
   if (gOptKeyPressed) {
     auto container = juce::DragAndDropContainer::findParentDragContainerFor(this);
@@ -167,12 +182,15 @@ void ClipView::mouseDown(const juce::MouseEvent& e) {
 }
 
 void ClipView::mouseDoubleClick(const juce::MouseEvent&) {
+  // NOTE(luca): removing the view can delete it before its mouseUp, the gesture has to end here
+  endGesture();
   remove(id);
 }
 
 void ClipView::mouseUp(const juce::MouseEvent&) {
   isTrimDrag = false;
   mouseDownOffset = 0;
+  endGesture();
 }
 
 void ClipView::mouseDrag(const juce::MouseEvent& e) {
@@ -279,6 +297,8 @@ void AutomationLane::mouseExit(const juce::MouseEvent&) {
 void AutomationLane::mouseDown(const juce::MouseEvent& e) {
   assert(activeGesture == GestureType::none);
 
+  beginGesture();
+
   auto point = getAutomationPoint(e.position);
   auto distance = point.getDistanceFrom(e.position);
 
@@ -316,6 +336,8 @@ void AutomationLane::mouseUp(const juce::MouseEvent&) {
 
   activeGesture = GestureType::none;
   setMouseCursor(juce::MouseCursor::NormalCursor);
+
+  endGesture();
 }
 
 void AutomationLane::mouseDrag(const juce::MouseEvent& e) {
@@ -502,262 +524,310 @@ void ToolBar::paint(juce::Graphics& g) {
   g.fillAll(Colours::eerieBlack);
 }
 
-void DefaultView::PluginsPanel::paint(juce::Graphics& g) {
-  g.fillAll(Colours::jet);
+DefaultView::ListPanel::ListPanel(const juce::String& t, juce::Colour c) : title(t), background(c) {}
+
+void DefaultView::ListPanel::paint(juce::Graphics& g) {
+  g.fillAll(background);
 
   {
     g.setColour(Colours::isabelline);
     g.setFont(Fonts::sofiaProRegular.withHeight(titleFontHeight));
-    g.drawText("Plug-ins", titleBounds, juce::Justification::left);
+    g.drawText(title, titleBounds, juce::Justification::left);
   }
-  
+
   g.setFont(Fonts::sofiaProRegular.withHeight(DefaultView::buttonFontHeight));
+  g.reduceClipRegion(listBounds);
 
-  for (u32 i = 0; i < plugins.size(); ++i) {
-    const auto& p = plugins[i];
+  auto clip = g.getClipBounds();
+  i32 top = clip.getY() - listBounds.getY() + scroll;
+  i32 bottom = clip.getBottom() - listBounds.getY() + scroll;
+  u32 first = u32(std::max(top / DefaultView::buttonHeight, 0));
+  u32 last = u32(std::clamp((bottom + DefaultView::buttonHeight - 1) / DefaultView::buttonHeight, 0, i32(numRows)));
 
-    if (p.visible) {
-      if (p.r.contains(getMouseXYRelative())) {
-        g.setColour(Colours::frenchGray);
-        g.fillRect(p.r);
-        g.setColour(Colours::eerieBlack);
-        g.drawText(p.format, p.r, juce::Justification::left);
-        g.drawText(p.description.name, p.r.withX(Button::namePadding), juce::Justification::left);
-      } else {
-        g.setColour(Colours::isabelline);
-        g.drawText(p.format, p.r, juce::Justification::left);
-        g.drawText(p.description.name, p.r.withX(Button::namePadding), juce::Justification::left);
-      }
-    }
+  for (u32 i = first; i < last; ++i) {
+    paintRow(g, i, getRowBounds(i), i32(i) == hovered);
   }
 }
 
-void DefaultView::PluginsPanel::mouseMove(const juce::MouseEvent& e) {
-  auto p = e.position.toInt();
-  auto it = std::find_if(plugins.begin(), plugins.end(), [p] (const auto& p_) { return p_.r.contains(p); });
-
-  if (it != plugins.end()) {
-    setMouseCursor(juce::MouseCursor::PointingHandCursor); 
-  } else {
-    setMouseCursor(juce::MouseCursor::NormalCursor); 
-  }
+void DefaultView::ListPanel::mouseMove(const juce::MouseEvent& e) {
+  setHovered(getRowAt(e.position.toInt()));
+}
 
-  repaint();
+void DefaultView::ListPanel::mouseExit(const juce::MouseEvent&) {
+  setHovered(NONE);
 }
 
-void DefaultView::PluginsPanel::mouseDown(const juce::MouseEvent& e) {
-  for (u32 i = 0; i < plugins.size(); ++i) {
-    const auto& p = plugins[i];
+void DefaultView::ListPanel::mouseDown(const juce::MouseEvent& e) {
+  i32 i = getRowAt(e.position.toInt());
 
-    if (p.visible && p.r.contains(e.position.toInt())) {
-      loadPlugin(p.description.createIdentifierString());
-      break;
-    }
+  if (i != NONE) {
+    rowClicked(u32(i));
   }
 }
 
-void DefaultView::PluginsPanel::mouseWheelMove(const juce::MouseEvent&, const juce::MouseWheelDetails& w) {
-  i32 v = getY() + i32(100.f * w.deltaY);
-  v = std::clamp(v, - getHeight() + kDefaultViewHeight, 0);
-  setTopLeftPosition(getX(), v); 
+void DefaultView::ListPanel::mouseWheelMove(const juce::MouseEvent& e, const juce::MouseWheelDetails& w) {
+  i32 v = scroll - i32(100.f * w.deltaY);
+  v = std::clamp(v, 0, getMaxScroll());
+
+  if (v != scroll) {
+    scroll = v;
+    hovered = getRowAt(e.position.toInt());
+    repaint(listBounds);
+  }
 }
 
-void DefaultView::PluginsPanel::resized() {
+void DefaultView::ListPanel::resized() {
   auto r = getLocalBounds();
   r.removeFromLeft(DefaultView::panelPadding);
   r.removeFromRight(DefaultView::panelPadding);
+
   titleBounds = r.removeFromTop(DefaultView::titleHeight);
+  listBounds = r;
+  scroll = std::clamp(scroll, 0, getMaxScroll());
+}
 
-  for (auto& p : plugins) {
-    if (p.visible) {
-      p.r = r.removeFromTop(DefaultView::buttonHeight);
-    }
+void DefaultView::ListPanel::setNumRows(u32 n) {
+  numRows = n;
+  scroll = std::clamp(scroll, 0, getMaxScroll());
+  hovered = NONE;
+  repaint();
+}
+
+void DefaultView::ListPanel::setHovered(i32 i) {
+  if (i != hovered) {
+    repaintRow(hovered);
+    hovered = i;
+    repaintRow(hovered);
+    setMouseCursor(hovered != NONE ? juce::MouseCursor::PointingHandCursor : juce::MouseCursor::NormalCursor);
   }
 }
 
-void DefaultView::PluginsPanel::update(juce::Array<juce::PluginDescription> descriptions) {
-  plugins.clear();
+void DefaultView::ListPanel::repaintRow(i32 i) {
+  if (i != NONE) {
+    repaint(getRowBounds(u32(i)).getIntersection(listBounds));
+  }
+}
 
-  for (const auto& t : descriptions) {
-    plugins.push_back(Button { t }); 
-    
-    auto& p = plugins.back();
-    p.format = p.description.pluginFormatName == "AudioUnit" ? "AU" : p.description.pluginFormatName;
+juce::Rectangle<i32> DefaultView::ListPanel::getRowBounds(u32 i) {
+  return { listBounds.getX(), listBounds.getY() + i32(i) * DefaultView::buttonHeight - scroll, listBounds.getWidth(), DefaultView::buttonHeight };
+}
+
+i32 DefaultView::ListPanel::getRowAt(juce::Point<i32> p) {
+  if (!listBounds.contains(p)) {
+    return NONE;
   }
 
-  updateManufacturerFilter(filter);
+  i32 i = (p.y - listBounds.getY() + scroll) / DefaultView::buttonHeight;
+  return i < i32(numRows) ? i : NONE;
 }
 
-void DefaultView::PluginsPanel::updateManufacturerFilter(const juce::String& m) {
-  filter = m; 
+i32 DefaultView::ListPanel::getMaxScroll() {
+  return std::max(i32(numRows) * DefaultView::buttonHeight - listBounds.getHeight(), 0);
+}
 
-  i32 count = 0;
-  for (auto& p : plugins) {
-    if (p.description.manufacturerName == filter) {
-      ++count;
-      p.visible = true;
-    } else {
-      p.visible = false;
-    }
+DefaultView::PluginsPanel::PluginsPanel(const PluginIndex& i) : ListPanel("Plug-ins", Colours::jet), index(i) {}
+
+void DefaultView::PluginsPanel::paintRow(juce::Graphics& g, u32 i, juce::Rectangle<i32> r, bool highlighted) {
+  const auto& entry = index.entries[rows[i]];
+
+  if (highlighted) {
+    g.setColour(Colours::frenchGray);
+    g.fillRect(r);
+    g.setColour(Colours::eerieBlack);
+  } else {
+    g.setColour(Colours::isabelline);
   }
 
-  i32 newHeight = DefaultView::buttonHeight * count + DefaultView::titleHeight;
-  setTopLeftPosition(getX(), 0);
-  setSize(kDefaultViewWidth / 2, newHeight < kDefaultViewHeight ? kDefaultViewHeight : newHeight);
-  resized();
-  repaint();
+  g.drawText(entry.format, r, juce::Justification::left);
+  g.drawText(entry.description.name, r.withX(namePadding), juce::Justification::left);
 }
 
-DefaultView::ManufacturersPanel::ManufacturersPanel(PluginsPanel& p) : pluginsPanel(p) {}
+void DefaultView::PluginsPanel::rowClicked(u32 i) {
+  loadPlugin(index.entries[rows[i]].description.createIdentifierString());
+}
+
+void DefaultView::PluginsPanel::update(const std::vector<u32>& entries) {
+  rows = entries;
+  scroll = 0;
+  setNumRows(u32(rows.size()));
+}
+
+DefaultView::ManufacturersPanel::ManufacturersPanel(const PluginIndex& i) : ListPanel("Manufacturers", Colours::eerieBlack), index(i) {}
 
 void DefaultView::ManufacturersPanel::paint(juce::Graphics& g) {
-  g.fillAll(Colours::eerieBlack);
+  ListPanel::paint(g);
 
-  {
+  if (numRows == 0) {
     g.setColour(Colours::isabelline);
-    g.setFont(Fonts::sofiaProRegular.withHeight(titleFontHeight));
-    g.drawText("Manufacturers", titleBounds, juce::Justification::left);
+    g.drawText("Drag and drop a VST3/AU or press S to scan", getLocalBounds(), juce::Justification::centred); 
   }
-  
-  g.setFont(Fonts::sofiaProRegular.withHeight(DefaultView::buttonFontHeight));
-  
-  for (u32 i = 0; i < manufacturers.size(); ++i) {
-    const auto& m = manufacturers[i];
-
-    if (m.r.contains(getMouseXYRelative()) || i == activeButton) {
-      g.setColour(Colours::frenchGray);
-      g.fillRect(m.r);
-      g.setColour(Colours::eerieBlack);
-      g.drawText(m.name, m.r, juce::Justification::left);
-    } else {
-      g.setColour(Colours::isabelline);
-      g.drawText(m.name, m.r, juce::Justification::left);
-    }
+}
+
+void DefaultView::ManufacturersPanel::paintRow(juce::Graphics& g, u32 i, juce::Rectangle<i32> r, bool highlighted) {
+  if (highlighted || i32(i) == activeButton) {
+    g.setColour(Colours::frenchGray);
+    g.fillRect(r);
+    g.setColour(Colours::eerieBlack);
+  } else {
+    g.setColour(Colours::isabelline);
   }
 
-  if (manufacturers.empty()) {
-    g.drawText("Drag and drop a VST3/AU to start", getLocalBounds(), juce::Justification::centred); 
+  g.drawText(index.manufacturers[i32(i)], r, juce::Justification::left);
+}
 
-  }
+void DefaultView::ManufacturersPanel::rowClicked(u32 i) {
+  select(i);
 }
 
-void DefaultView::ManufacturersPanel::mouseMove(const juce::MouseEvent& e) {
-  auto p = e.position.toInt();
-  auto it = std::find_if(manufacturers.begin(), manufacturers.end(), [p] (const auto& m) { return m.r.contains(p); });
+void DefaultView::ManufacturersPanel::update() {
+  setNumRows(u32(index.manufacturers.size()));
+}
 
-  if (it != manufacturers.end()) {
-    setMouseCursor(juce::MouseCursor::PointingHandCursor); 
-  } else {
-    setMouseCursor(juce::MouseCursor::NormalCursor); 
+void DefaultView::ManufacturersPanel::setActive(i32 i) {
+  if (i != activeButton) {
+    repaintRow(activeButton);
+    activeButton = i;
+    repaintRow(activeButton);
   }
-
-  repaint();
 }
 
-void DefaultView::ManufacturersPanel::mouseDown(const juce::MouseEvent& e) {
-  for (u32 i = 0; i < manufacturers.size(); ++i) {
-    if (manufacturers[i].r.contains(e.position.toInt())) {
-      activeButton = i;
-      pluginsPanel.updateManufacturerFilter(manufacturers[i].name);
-      break;
-    }
-  }
+DefaultView::DefaultView(StateManager& m, juce::KnownPluginList& kpl, PluginScanner& s) : manager(m), knownPluginList(kpl), scanner(s) {
+  pluginsPanel.loadPlugin = [this] (const juce::String& id) { manager.loadPlugin(id); };
+  manufacturersPanel.select = [this] (u32 i) { showManufacturer(i); };
 
-  repaint();
-}
+  searchBox.setFont(juce::Font(Fonts::sofiaProRegular.withHeight(buttonFontHeight)));
+  searchBox.setTextToShowWhenEmpty("Search", Colours::frenchGray);
+  searchBox.setColour(juce::TextEditor::backgroundColourId, Colours::eerieBlack);
+  searchBox.setColour(juce::TextEditor::textColourId, Colours::isabelline);
+  searchBox.setColour(juce::TextEditor::outlineColourId, Colours::outerSpace);
+  searchBox.setColour(juce::TextEditor::focusedOutlineColourId, Colours::glaucous);
+  searchBox.onTextChange = [this] { updateSearch(); };
+  searchBox.onEscapeKey = [this] { searchBox.clear(); updateSearch(); };
+
+  addAndMakeVisible(manufacturersPanel);
+  addAndMakeVisible(pluginsPanel);
+  addAndMakeVisible(searchBox);
+  addChildComponent(loadingView);
 
-void DefaultView::ManufacturersPanel::mouseWheelMove(const juce::MouseEvent&, const juce::MouseWheelDetails& w) {
-  i32 v = getY() + i32(100.f * w.deltaY);
-  v = std::clamp(v, - getHeight() + kDefaultViewHeight, 0);
-  setTopLeftPosition(getX(), v); 
+  updateIndex();
 }
 
-void DefaultView::ManufacturersPanel::resized() {
+void DefaultView::resized() {
   auto r = getLocalBounds();
-  r.removeFromLeft(DefaultView::panelPadding);
-  r.removeFromRight(DefaultView::panelPadding);
+  loadingView.setBounds(r);
 
-  titleBounds = r.removeFromTop(DefaultView::titleHeight);
+  auto l = r.removeFromLeft(r.getWidth() / 2);
 
-  for (auto& m : manufacturers) {
-    m.r = r.removeFromTop(DefaultView::buttonHeight);
-  }
+  manufacturersPanel.setBounds(l); 
+  pluginsPanel.setBounds(r); 
+
+  searchBox.setBounds(r.getRight() - panelPadding - searchWidth, r.getY() + (titleHeight - searchHeight) / 2, searchWidth, searchHeight);
 }
 
-void DefaultView::ManufacturersPanel::update(juce::Array<juce::PluginDescription> descriptions) {
-  juce::StringArray manufacturerNames;
+void DefaultView::updateIndex() {
+  juce::String current;
 
-  for (const auto& t : descriptions) {
-    manufacturerNames.add(t.manufacturerName);
+  if (manufacturersPanel.activeButton != NONE) {
+    current = index.manufacturers[manufacturersPanel.activeButton];
   }
 
-  manufacturerNames.removeDuplicates(false);
-  manufacturerNames.sortNatural();
+  index.rebuild(knownPluginList);
+  manufacturersPanel.update();
 
-  juce::String currentManufacturer;
-
-  if (activeButton < manufacturers.size()) {
-    currentManufacturer = manufacturers[activeButton].name;
+  if (index.manufacturers.isEmpty()) {
+    manufacturersPanel.activeButton = NONE;
+  } else {
+    i32 i = index.findManufacturer(current);
+    manufacturersPanel.activeButton = i == NONE ? 0 : i;
   }
 
-  manufacturers.clear();
+  updateSearch();
+}
+
+void DefaultView::showManufacturer(u32 i) {
+  assert(i < index.buckets.size());
 
-  for (const auto& n : manufacturerNames) {
-    manufacturers.push_back(Button { n, {} });
-  }
-  
-  activeButton = 0;
-  for (u32 i = 0; i < manufacturers.size(); ++i) {
-    if (manufacturers[i].name == currentManufacturer) {
-      activeButton = i;
-      break;
-    }
-  }
+  manufacturersPanel.setActive(i32(i));
 
-  if (currentManufacturer == "" && !manufacturers.empty()) {
-    pluginsPanel.updateManufacturerFilter(manufacturers.front().name);
-    activeButton = 0;
+  searchBox.clear();
+  updateSearch();
+}
+
+void DefaultView::updateSearch() {
+  if (searchBox.isEmpty()) {
+    if (manufacturersPanel.activeButton != NONE) {
+      pluginsPanel.update(index.buckets[u32(manufacturersPanel.activeButton)]);
+    } else {
+      pluginsPanel.update({});
+    }
   } else {
-    pluginsPanel.updateManufacturerFilter(currentManufacturer);
+    index.search(searchBox.getText(), searchResults);
+    pluginsPanel.update(searchResults);
   }
+}
 
-  i32 newHeight = DefaultView::buttonHeight * i32(manufacturers.size()) + DefaultView::titleHeight;
-  setSize(kDefaultViewWidth / 2, newHeight < kDefaultViewHeight ? kDefaultViewHeight : newHeight);
-  resized();
+bool DefaultView::isInterestedInFileDrag(const juce::StringArray&){
+  return true; 
 }
 
-DefaultView::DefaultView(StateManager& m, juce::AudioPluginFormatManager& fm, juce::KnownPluginList& kpl) : manager(m), knownPluginList(kpl), formatManager(fm) {
-  pluginsPanel.loadPlugin = [this] (const juce::String& id) { manager.loadPlugin(id); };
+void DefaultView::setLoading(const juce::String& name) {
+  loadingView.name = name;
+  loadingView.setVisible(name.isNotEmpty());
+  loadingView.repaint();
+}
 
-  addAndMakeVisible(manufacturersPanel);
-  addAndMakeVisible(pluginsPanel);
+void DefaultView::setRecoverable(bool shouldBeRecoverable) {
+  recoverable = shouldBeRecoverable;
+  repaint();
 }
 
-void DefaultView::resized() {
-  auto r = getLocalBounds();
-  auto l = r.removeFromLeft(r.getWidth() / 2);
+DefaultView::LoadingView::LoadingView() {
+  progressBar.setPercentageDisplay(false);
+  progressBar.setColour(juce::ProgressBar::backgroundColourId, Colours::jet);
+  progressBar.setColour(juce::ProgressBar::foregroundColourId, Colours::glaucous);
+  addAndMakeVisible(progressBar);
+}
 
-  manufacturersPanel.setTopLeftPosition(l.getX(), l.getY()); 
-  pluginsPanel.setTopLeftPosition(r.getX(), r.getY()); 
+void DefaultView::LoadingView::paint(juce::Graphics& g) {
+  g.fillAll(Colours::eerieBlack);
+  g.setColour(Colours::isabelline);
+  g.setFont(Fonts::sofiaProRegular.withHeight(DefaultView::buttonFontHeight));
+  g.drawText("Loading " + name + "...", getLocalBounds().withTrimmedBottom(DefaultView::buttonHeight * 2), juce::Justification::centred);
+}
 
-  manufacturersPanel.update(knownPluginList.getTypes());
-  pluginsPanel.update(knownPluginList.getTypes());
+void DefaultView::LoadingView::resized() {
+  progressBar.setBounds(getLocalBounds().withSizeKeepingCentre(barWidth, barHeight));
 }
 
-bool DefaultView::isInterestedInFileDrag(const juce::StringArray&){
-  return true; 
+void DefaultView::paintOverChildren(juce::Graphics& g) {
+  juce::String banner;
+
+  if (scanner.isScanning()) {
+    banner = "Scanning plug-ins...";
+  } else if (recoverable && !loadingView.isVisible()) {
+    banner = "Press R to recover an unsaved session";
+  }
+
+  if (banner.isNotEmpty()) {
+    auto r = getLocalBounds().removeFromBottom(buttonHeight);
+    g.setColour(Colours::eerieBlack);
+    g.fillRect(r);
+    g.setColour(Colours::isabelline);
+    g.setFont(Fonts::sofiaProRegular.withHeight(buttonFontHeight));
+    g.drawText(banner, r, juce::Justification::centred);
+  }
 }
 
 void DefaultView::filesDropped(const juce::StringArray& files, i32, i32) {
-  juce::OwnedArray<juce::PluginDescription> types;
-  knownPluginList.scanAndAddDragAndDroppedFiles(formatManager, files, types);
-  saveKnownPluginList(knownPluginList); 
-  resized();
+  scanner.scan(files);
+  repaint();
 }
 
 MainView::MainView() {
   addAndMakeVisible(toolBar);
   addAndMakeVisible(track);
+  addChildComponent(pad);
+  addChildComponent(parametersView);
   addChildComponent(infoView);
 
   infoView.mainViewUpdateCallback = [this] { toggleInfoView(); };
@@ -778,12 +848,255 @@ void MainView::resized() {
 
   track.setTopLeftPosition(r.getTopLeft());
   track.setSize(kWidth, kTrackHeight);
+  pad.setBounds(r.getX(), r.getY(), kWidth, kTrackHeight);
+  parametersView.setBounds(r);
 }
 
 void MainView::toggleInfoView() {
   infoView.setVisible(!infoView.isVisible());
 }
 
+void MainView::toggleParametersView() {
+  parametersView.setVisible(!parametersView.isVisible());
+}
+
+void MainView::setPadMode(bool m) {
+  track.setVisible(!m);
+  pad.setVisible(m);
+}
+
+ParametersView::ParametersView() : ListPanel("Parameters", Colours::eerieBlack) {
+  searchBox.setFont(juce::Font(Fonts::sofiaProRegular.withHeight(DefaultView::buttonFontHeight)));
+  searchBox.setTextToShowWhenEmpty("Search", Colours::frenchGray);
+  searchBox.setColour(juce::TextEditor::backgroundColourId, Colours::eerieBlack);
+  searchBox.setColour(juce::TextEditor::textColourId, Colours::isabelline);
+  searchBox.setColour(juce::TextEditor::outlineColourId, Colours::outerSpace);
+  searchBox.setColour(juce::TextEditor::focusedOutlineColourId, Colours::glaucous);
+  searchBox.onTextChange = [this] { updateSearch(); };
+  searchBox.onEscapeKey = [this] { searchBox.clear(); updateSearch(); };
+
+  addAndMakeVisible(searchBox);
+}
+
+void ParametersView::resized() {
+  ListPanel::resized();
+  searchBox.setBounds(titleBounds.getRight() - searchWidth, titleBounds.getY() + (titleBounds.getHeight() - searchHeight) / 2, searchWidth, searchHeight);
+}
+
+void ParametersView::mouseDown(const juce::MouseEvent& e) {
+  i32 row = getRowAt(e.position.toInt());
+
+  if (row == NONE) {
+    return;
+  }
+
+  u32 i = rows[u32(row)];
+  auto r = getRowBounds(u32(row));
+
+  if (getToggleBounds(r).contains(e.position.toInt())) {
+    toggleActive(i);
+  } else if (getCurveBounds(r).contains(e.position.toInt())) {
+    cycleCurve(i);
+  }
+}
+
+void ParametersView::paintRow(juce::Graphics& g, u32 row, juce::Rectangle<i32> r, bool highlighted) {
+  static constexpr const char* curveNames[] = { "Linear", "Exponential", "S-curve", "Step" };
+
+  u32 i = rows[row];
+
+  if (highlighted) {
+    g.setColour(Colours::jet);
+    g.fillRect(r);
+  }
+
+  {
+    auto t = getToggleBounds(r).toFloat();
+    g.setColour(active[i] ? Colours::shamrockGreen : Colours::frenchGray);
+    g.fillRoundedRectangle(t, 2);
+    g.setColour(Colours::eerieBlack);
+    g.setFont(Fonts::sofiaProMedium.withHeight(9));
+    g.drawText(active[i] ? "ON" : "OFF", t, juce::Justification::centred);
+  }
+
+  g.setFont(Fonts::sofiaProRegular.withHeight(DefaultView::buttonFontHeight));
+
+  {
+    auto v = getValueBounds(r);
+    auto bar = v.removeFromLeft(v.getWidth() - 36).reduced(0, 10).toFloat();
+    g.setColour(Colours::outerSpace);
+    g.fillRect(bar);
+    g.setColour(active[i] ? Colours::glaucous : Colours::frenchGray);
+    g.fillRect(bar.withWidth(bar.getWidth() * values[i]));
+    g.setColour(Colours::frenchGray);
+    g.drawText(juce::String(values[i], 2), v, juce::Justification::right);
+  }
+
+  g.setColour(Colours::frenchGray);
+  g.drawText(curveNames[curves[i] % kNumCurves], getCurveBounds(r), juce::Justification::left);
+
+  auto name = r.withTrimmedLeft(toggleWidth + rowPadding).withTrimmedRight(curveWidth + valueWidth + rowPadding * 2);
+  g.setColour(Colours::isabelline);
+  g.drawText(names[i32(i)], name, juce::Justification::left, true);
+}
+
+void ParametersView::rowClicked(u32) {}
+
+void ParametersView::setParameters(const juce::StringArray& n) {
+  names = n;
+  index.rebuild(names);
+
+  u32 numParameters = u32(names.size());
+  values.resize(numParameters, 0);
+  active.resize(numParameters, 1);
+  curves.resize(numParameters, 0);
+
+  updateSearch();
+}
+
+void ParametersView::setValue(u32 i, f32 v) {
+  if (neqf32(values[i], v)) {
+    values[i] = v;
+    repaintParameter(i);
+  }
+}
+
+void ParametersView::repaintParameter(u32 i) {
+  if (isVisible() && i < rowOf.size()) {
+    repaintRow(rowOf[i]);
+  }
+}
+
+void ParametersView::updateSearch() {
+  index.search(searchBox.getText(), rows);
+  rowOf.assign(u32(names.size()), NONE);
+
+  for (u32 r = 0; r < rows.size(); ++r) {
+    rowOf[rows[r]] = i32(r);
+  }
+
+  scroll = 0;
+  setNumRows(u32(rows.size()));
+}
+
+juce::Rectangle<i32> ParametersView::getToggleBounds(juce::Rectangle<i32> r) {
+  return r.removeFromLeft(toggleWidth).reduced(0, 5);
+}
+
+juce::Rectangle<i32> ParametersView::getCurveBounds(juce::Rectangle<i32> r) {
+  r.removeFromRight(valueWidth + rowPadding);
+  return r.removeFromRight(curveWidth);
+}
+
+juce::Rectangle<i32> ParametersView::getValueBounds(juce::Rectangle<i32> r) {
+  return r.removeFromRight(valueWidth);
+}
+
+juce::Rectangle<f32> PadView::getPadBounds() {
+  auto r = getLocalBounds().reduced(padding).toFloat();
+  f32 side = std::min(r.getWidth(), r.getHeight());
+  return r.withSizeKeepingCentre(side, side);
+}
+
+juce::Point<f32> PadView::toPad(juce::Point<f32> p) {
+  auto r = getPadBounds();
+  return { std::clamp((p.x - r.getX()) / r.getWidth(), 0.f, 1.f), std::clamp(1 - (p.y - r.getY()) / r.getHeight(), 0.f, 1.f) };
+}
+
+juce::Point<f32> PadView::fromPad(juce::Point<f32> p) {
+  auto r = getPadBounds();
+  return { r.getX() + p.x * r.getWidth(), r.getY() + (1 - p.y) * r.getHeight() };
+}
+
+i32 PadView::getPointAt(juce::Point<f32> p) {
+  for (i32 i = i32(points.size()) - 1; i >= 0; --i) {
+    if (fromPad(points[u32(i)]).getDistanceFrom(p) <= pointSize / 2) {
+      return i;
+    }
+  }
+
+  return NONE;
+}
+
+void PadView::paint(juce::Graphics& g) {
+  g.fillAll(Colours::eerieBlack);
+
+  auto r = getPadBounds();
+
+  g.setColour(Colours::jet);
+  g.fillRect(r);
+  g.setColour(Colours::outerSpace);
+  g.drawRect(r, Style::lineThickness);
+
+  // NOTE(luca): same weights the engine uses, shown as the opacity of the link to each clip
+  Engine::computePadWeights(points, position.x, position.y, weights, contributors);
+
+  auto cursor = fromPad(position);
+
+  for (u32 i : contributors) {
+    g.setColour(Colours::frenchGray.withAlpha(weights[i]));
+    g.drawLine({ cursor, fromPad(points[i]) }, Style::lineThickness);
+  }
+
+  g.setFont(font);
+
+  for (u32 i = 0; i < points.size(); ++i) {
+    auto p = fromPad(points[i]);
+    auto bounds = juce::Rectangle<f32>(pointSize, pointSize).withCentre(p);
+
+    g.setColour(Colours::auburn);
+    g.fillEllipse(bounds);
+
+    if (i32(i) == draggedPoint) {
+      g.setColour(Colours::shamrockGreen);
+      g.drawEllipse(bounds.reduced(Style::lineThicknessHighlighted / 2), Style::lineThicknessHighlighted);
+    }
+
+    g.setColour(Colours::isabelline);
+    g.drawText(juce::String(i + 1), bounds.translated(0, pointSize), juce::Justification::centred);
+  }
+
+  g.setColour(Colours::atomicTangerine);
+  g.fillEllipse(juce::Rectangle<f32>(cursorSize, cursorSize).withCentre(cursor));
+}
+
+void PadView::mouseDown(const juce::MouseEvent& e) {
+  draggedPoint = getPointAt(e.position);
+
+  if (draggedPoint != NONE) {
+    beginPointGesture();
+  } else {
+    draggingCursor = true;
+    beginGesture();
+    auto p = toPad(e.position);
+    setPosition(p.x, p.y);
+  }
+
+  repaint();
+}
+
+void PadView::mouseDrag(const juce::MouseEvent& e) {
+  auto p = toPad(e.position);
+
+  if (draggedPoint != NONE) {
+    movePoint(u32(draggedPoint), p.x, p.y);
+  } else if (draggingCursor) {
+    setPosition(p.x, p.y);
+  }
+}
+
+void PadView::mouseUp(const juce::MouseEvent&) {
+  if (draggedPoint != NONE) {
+    draggedPoint = NONE;
+    endPointGesture();
+  } else if (draggingCursor) {
+    draggingCursor = false;
+    endGesture();
+  }
+
+  repaint();
+}
+
 Editor::Editor(Plugin& p) : AudioProcessorEditor(&p), proc(p) {
   addChildComponent(defaultView);
   addChildComponent(mainView);
@@ -821,11 +1134,18 @@ bool Editor::keyPressed(const juce::KeyPress& k) {
   static constexpr i32 keyMin = 45;
   static constexpr i32 keyEquals = 61;
 
+  static constexpr i32 keyCharA = 65;
+  static constexpr i32 keyCharC = 67;
   static constexpr i32 keyCharD = 68;
   static constexpr i32 keyCharE = 69;
   static constexpr i32 keyCharI = 73;
   static constexpr i32 keyCharK = 75;
+  static constexpr i32 keyCharL = 76;
+  static constexpr i32 keyCharP = 80;
+  static constexpr i32 keyCharQ = 81;
   static constexpr i32 keyCharR = 82;
+  static constexpr i32 keyCharS = 83;
+  static constexpr i32 keyCharZ = 90;
 
   static constexpr i32 keyLeft  = 63234;
   static constexpr i32 keyRight = 63235;
@@ -862,6 +1182,15 @@ bool Editor::keyPressed(const juce::KeyPress& k) {
       case keyCharE: {
         manager.setAllParametersActive(true);
       } break;
+      case keyCharZ: {
+        if (manager.instance) {
+          if (modifier.isShiftDown()) {
+            manager.redo();
+          } else {
+            manager.undo();
+          }
+        }
+      } break;
     };
   } else {
     switch (code) {
@@ -884,11 +1213,49 @@ bool Editor::keyPressed(const juce::KeyPress& k) {
         manager.setDiscreteMode(!manager.discreteMode);
       } break;
       case keyCharR: {
-        manager.randomiseParameters();
+        if (manager.instance && modifier.isShiftDown()) {
+          manager.generateVariations(kNumVariations);
+        } else if (manager.instance) {
+          manager.randomiseParameters();
+        } else if (defaultView.recoverable) {
+          defaultView.setRecoverable(false);
+          manager.recoverSession();
+        }
+      } break;
+      case keyCharA: {
+        if (manager.instance) {
+          manager.setRecordMode(!manager.recordMode);
+        }
       } break;
       case keyCharK: {
         manager.loadPlugin({}); 
       } break;
+      case keyCharC: {
+        if (manager.instance) {
+          manager.cycleLastTouchedParameterCurve();
+        }
+      } break;
+      case keyCharL: {
+        if (instanceWindow) {
+          manager.toggleParametersView();
+        }
+      } break;
+      case keyCharP: {
+        if (manager.instance) {
+          manager.setPadMode(!manager.padMode);
+        }
+      } break;
+      case keyCharQ: {
+        if (manager.instance) {
+          manager.setQuantizeClips(!manager.quantizeClips);
+        }
+      } break;
+      case keyCharS: {
+        if (!manager.instance) {
+          proc.library->getScanner().scanDefaultLocations();
+          defaultView.repaint();
+        }
+      } break;
       case keyCharI: {
         if (instanceWindow) {
           mainView.toggleInfoView();
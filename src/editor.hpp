@@ -1,6 +1,8 @@
 #pragma once
 
 #include "plugin.hpp"
+#include "plugin_index.hpp"
+#include "parameter_index.hpp"
 #include <numbers>
 
 namespace atmt {
@@ -62,7 +64,7 @@ struct InfoView : juce::Component {
     const char* binding;
   };
 
-  static constexpr i32 commandHeight = 18;
+  static constexpr i32 commandHeight = 13;
   static constexpr Command commands[] =
   {  
     { "Enable all parameters",      "Command + E" },
@@ -70,7 +72,13 @@ struct InfoView : juce::Component {
     { "Capture parameter",          "Command + Click" },
     { "Release parameter",          "Command + Shift + Click " },
     { "Randomise parameters",       "R" },
+    { "Vary selected clip",         "Shift + R" },
+    { "Toggle recording",           "A" },
     { "Kill instance",              "K" },
+    { "Toggle 16-bit clip storage", "Q" },
+    { "Toggle xy pad",              "P" },
+    { "Cycle response curve",       "C" },
+    { "Show parameters",            "L" },
     { "Narrow grid",                "Command + 1" },
     { "Widen grid",                 "Command + 2" },
     { "Toggle triplet grid",        "Command + 3" },
@@ -82,6 +90,8 @@ struct InfoView : juce::Component {
     { "Delete clip",                "Double click on clip" },
     { "Duplicate clip",             "Alt/Opt + click + drag" },
     { "Delete selection",           "Backspace" },
+    { "Undo",                       "Command + Z" },
+    { "Redo",                       "Command + Shift + Z" },
     { "Toggle info view",           "I" }
   };
 
@@ -91,17 +101,22 @@ struct InfoView : juce::Component {
   void mouseDown(const juce::MouseEvent&) override;
 
   std::function<void()> mainViewUpdateCallback;
+  juce::String memoryUsage;
   const juce::Font font { Fonts::sofiaProLight.withHeight(12) };
 };
 
 struct PathView : juce::Component {
   PathView();
   void paint(juce::Graphics&) override;
+  void mouseDown(const juce::MouseEvent&) override;
+  void mouseUp(const juce::MouseEvent&) override;
   void mouseDrag(const juce::MouseEvent&) override;
   void mouseDoubleClick(const juce::MouseEvent&) override;
 
   std::function<void(u32, f32, f32)> move;
   std::function<void(u32)> remove;
+  std::function<void()> beginGesture;
+  std::function<void()> endGesture;
   u32 id = 0;
   static constexpr i32 size = 20;
   static constexpr i32 posOffset = size / 2;
@@ -118,6 +133,8 @@ struct ClipView : juce::Component {
   std::function<void(u32, f32, f32)> move;
   std::function<void(u32)> remove;
   std::function<void(i32)> select;
+  std::function<void()> beginGesture;
+  std::function<void()> endGesture;
   bool selected = false;
   u32 id = 0;
   static constexpr i32 trimThreshold = 20;
@@ -148,6 +165,8 @@ struct AutomationLane : juce::Component {
   std::function<void(f32)> flattenAutomationCurve;
   std::function<void(f32, f32)> dragAutomationSection;
   std::function<void(u32, f32, f32)> movePath;
+  std::function<void()> beginGesture;
+  std::function<void()> endGesture;
 
   juce::Path automation;
   juce::OwnedArray<PathView> pathViews;
@@ -251,98 +270,178 @@ struct DefaultView : juce::Component, juce::FileDragAndDropTarget {
   static constexpr i32 buttonFontHeight = 14;
   static constexpr i32 panelPadding = 20;
 
-  struct PluginsPanel : juce::Component {
-    struct Button {   
-      juce::PluginDescription description;
-      juce::Rectangle<i32> r {};
-      bool visible = false;
-      juce::String format = "";
-      static constexpr i32 namePadding = 80;
-    };
-
-    void paint(juce::Graphics&);
-    void mouseMove(const juce::MouseEvent&);
-    void mouseDown(const juce::MouseEvent&);
-    void mouseWheelMove(const juce::MouseEvent&, const juce::MouseWheelDetails&);
-    void resized();
-    void update(juce::Array<juce::PluginDescription>);
-    void updateManufacturerFilter(const juce::String&);
+  // NOTE(luca): only the rows that intersect the visible area are laid out and painted, scrolling just
+  // moves the offset and hovering repaints the two rows that changed
+  struct ListPanel : juce::Component {
+    ListPanel(const juce::String&, juce::Colour);
 
-    std::function<void(const juce::String&)> loadPlugin;
+    void paint(juce::Graphics&) override;
+    void mouseMove(const juce::MouseEvent&) override;
+    void mouseExit(const juce::MouseEvent&) override;
+    void mouseDown(const juce::MouseEvent&) override;
+    void mouseWheelMove(const juce::MouseEvent&, const juce::MouseWheelDetails&) override;
+    void resized() override;
+
+    virtual void paintRow(juce::Graphics&, u32, juce::Rectangle<i32>, bool) = 0;
+    virtual void rowClicked(u32) = 0;
+
+    void setNumRows(u32);
+    void setHovered(i32);
+    void repaintRow(i32);
+    juce::Rectangle<i32> getRowBounds(u32);
+    i32 getRowAt(juce::Point<i32>);
+    i32 getMaxScroll();
+
+    juce::String title;
+    juce::Colour background;
     juce::Rectangle<i32> titleBounds;
-    std::vector<Button> plugins;
-    juce::String filter;
+    juce::Rectangle<i32> listBounds;
+    u32 numRows = 0;
+    i32 scroll = 0;
+    i32 hovered = NONE;
   };
 
-  struct ManufacturersPanel : juce::Component {
-    struct Button {
-      juce::String name;
-      juce::Rectangle<i32> r;
-    };
+  struct PluginsPanel : ListPanel {
+    static constexpr i32 namePadding = 80;
 
-    ManufacturersPanel(PluginsPanel&);
+    PluginsPanel(const PluginIndex&);
 
-    void paint(juce::Graphics& g);
-    void mouseMove(const juce::MouseEvent&);
-    void mouseDown(const juce::MouseEvent&);
-    void mouseWheelMove(const juce::MouseEvent&, const juce::MouseWheelDetails&);
-    void resized();
-    void update(juce::Array<juce::PluginDescription>);
+    void paintRow(juce::Graphics&, u32, juce::Rectangle<i32>, bool) override;
+    void rowClicked(u32) override;
+    void update(const std::vector<u32>&);
 
-    PluginsPanel& pluginsPanel;
-    juce::Rectangle<i32> titleBounds;
-    std::vector<Button> manufacturers;
-    u32 activeButton = 0;
+    const PluginIndex& index;
+    std::function<void(const juce::String&)> loadPlugin;
+    std::vector<u32> rows;
   };
 
-  DefaultView(StateManager&, juce::AudioPluginFormatManager&, juce::KnownPluginList&);
+  struct ManufacturersPanel : ListPanel {
+    ManufacturersPanel(const PluginIndex&);
+
+    void paint(juce::Graphics&) override;
+    void paintRow(juce::Graphics&, u32, juce::Rectangle<i32>, bool) override;
+    void rowClicked(u32) override;
+    void update();
+    void setActive(i32);
+
+    const PluginIndex& index;
+    std::function<void(u32)> select;
+    i32 activeButton = NONE;
+  };
+
+  struct LoadingView : juce::Component {
+    LoadingView();
+    void paint(juce::Graphics&) override;
+    void resized() override;
+
+    f64 progress = -1;
+    juce::ProgressBar progressBar { progress };
+    juce::String name;
+    static constexpr i32 barWidth = 200;
+    static constexpr i32 barHeight = 6;
+  };
+
+  DefaultView(StateManager&, juce::KnownPluginList&, PluginScanner&);
   void resized() override;
+  void updateIndex();
+  void showManufacturer(u32);
+  void updateSearch();
+  void setLoading(const juce::String&);
+  void setRecoverable(bool);
+  void paintOverChildren(juce::Graphics&) override;
   bool isInterestedInFileDrag(const juce::StringArray&)	override;
   void filesDropped(const juce::StringArray&, i32, i32) override;
 
   StateManager& manager;
   juce::KnownPluginList& knownPluginList;
-  juce::AudioPluginFormatManager& formatManager;
+  PluginScanner& scanner;
 
-  PluginsPanel pluginsPanel;
-  ManufacturersPanel manufacturersPanel { pluginsPanel};
-};
+  PluginIndex index;
+  std::vector<u32> searchResults;
 
-struct ParameterView : juce::Component {
-  struct Button : juce::ToggleButton {
-    Button() {
-      setTriggeredOnMouseDown(true);
-    }
+  PluginsPanel pluginsPanel { index };
+  ManufacturersPanel manufacturersPanel { index };
+  juce::TextEditor searchBox;
+  LoadingView loadingView;
+  bool recoverable = false;
 
-    void paintButton(juce::Graphics& g, bool highlighted, bool) {
-      g.setColour(highlighted ? Colours::isabelline : Colours::frenchGray);
-      g.fillRoundedRectangle(getLocalBounds().toFloat(), 2);
-      g.setColour(Colours::eerieBlack);
-      g.setFont(Fonts::sofiaProMedium.withHeight(9));
-
-      if (getToggleState()) {
-        g.drawText("ON", getLocalBounds(), juce::Justification::centred);
-      } else {
-        g.drawText("OFF", getLocalBounds(), juce::Justification::centred);
-      }
-    }
-  };
+  static constexpr i32 searchWidth = 140;
+  static constexpr i32 searchHeight = 24;
+};
+
+// NOTE(luca): overlay listing every parameter of the hosted plug-in. Rows are painted from plain arrays
+// filled by StateManager, nothing is allocated per parameter and values come from the engine's feed.
+struct ParametersView : DefaultView::ListPanel {
+  ParametersView();
 
-  ParameterView();
   void resized() override;
-  void paint(juce::Graphics& g) override;
+  void mouseDown(const juce::MouseEvent&) override;
+  void paintRow(juce::Graphics&, u32, juce::Rectangle<i32>, bool) override;
+  void rowClicked(u32) override;
+
+  void setParameters(const juce::StringArray&);
+  void setValue(u32, f32);
+  void repaintParameter(u32);
+  void updateSearch();
+
+  static juce::Rectangle<i32> getToggleBounds(juce::Rectangle<i32>);
+  static juce::Rectangle<i32> getCurveBounds(juce::Rectangle<i32>);
+  static juce::Rectangle<i32> getValueBounds(juce::Rectangle<i32>);
+
+  std::function<void(u32)> toggleActive;
+  std::function<void(u32)> cycleCurve;
+
+  juce::StringArray names;
+  std::vector<f32> values;
+  std::vector<u8> active;
+  std::vector<u8> curves;
+
+  ParameterIndex index;
+  std::vector<u32> rows;
+  std::vector<i32> rowOf;
+  juce::TextEditor searchBox;
+
+  static constexpr i32 toggleWidth = 34;
+  static constexpr i32 curveWidth = 80;
+  static constexpr i32 valueWidth = 110;
+  static constexpr i32 rowPadding = 8;
+  static constexpr i32 searchWidth = 140;
+  static constexpr i32 searchHeight = 24;
+};
 
-  Dial dial;
-  juce::Rectangle<i32> nameBounds;
-  Button activeToggle;
-  juce::String name;
-  u32 id = 0;
+// NOTE(luca): clips are placed as points on a 2D surface and the cursor blends between all of them,
+// dragging a point moves the clip, dragging anywhere else moves the cursor
+struct PadView : juce::Component {
+  void paint(juce::Graphics&) override;
+  void mouseDown(const juce::MouseEvent&) override;
+  void mouseDrag(const juce::MouseEvent&) override;
+  void mouseUp(const juce::MouseEvent&) override;
+
+  juce::Rectangle<f32> getPadBounds();
+  juce::Point<f32> toPad(juce::Point<f32>);
+  juce::Point<f32> fromPad(juce::Point<f32>);
+  i32 getPointAt(juce::Point<f32>);
+
+  std::function<void(f32, f32)> setPosition;
+  std::function<void(u32, f32, f32)> movePoint;
+  std::function<void()> beginGesture;
+  std::function<void()> endGesture;
+  std::function<void()> beginPointGesture;
+  std::function<void()> endPointGesture;
+
+  std::vector<juce::Point<f32>> points;
+  juce::Point<f32> position { 0.5f, 0.5f };
+  i32 draggedPoint = NONE;
+  bool draggingCursor = false;
+
+  std::vector<f32> weights;
+  std::vector<u32> contributors;
+
+  const juce::Font font { Fonts::sofiaProRegular.withHeight(12) };
 
-  static constexpr i32 dialSize = 60;
-  static constexpr i32 nameHeight = 20;
-  static constexpr i32 buttonSize = 20;
-  static constexpr i32 padding = 8;
-  static constexpr i32 height = dialSize + nameHeight + buttonSize + 3 * padding;
+  static constexpr i32 padding = 20;
+  static constexpr f32 pointSize = 16;
+  static constexpr f32 cursorSize = 10;
 };
 
 struct MainView : juce::Component {
@@ -350,9 +449,13 @@ struct MainView : juce::Component {
   void resized() override;
   void paint(juce::Graphics& g) override;
   void toggleInfoView();
+  void toggleParametersView();
+  void setPadMode(bool);
 
   InfoView infoView;
   TrackView track;
+  PadView pad;
+  ParametersView parametersView;
   ToolBar toolBar;
 };
 
@@ -388,7 +491,7 @@ struct Editor : juce::AudioProcessorEditor, juce::DragAndDropContainer {
 
   std::unique_ptr<InstanceWindow> instanceWindow;
   MainView mainView;
-  DefaultView defaultView { manager, proc.apfm, proc.knownPluginList };
+  DefaultView defaultView { manager, proc.library->getKnownPluginList(), proc.library->getScanner() };
 };
 
 } // namespace atmt
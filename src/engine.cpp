@@ -6,10 +6,93 @@ namespace atmt {
 Engine::Engine(StateManager& m) : manager(m) {}
 
 void Engine::prepare(f32 sampleRate, i32 blockSize) {
-  assert(instance);
+  auto* p = instance.load();
+  assert(p);
+
+  p->prepareToPlay(sampleRate, blockSize);
+  proc.setLatencySamples(p->getLatencySamples());
+}
+
+void Engine::prepareBuffers(u32 numParameters) {
+  JUCE_ASSERT_MESSAGE_THREAD
+
+  expandedA = { std::vector<f32>(numParameters), NONE };
+  expandedB = { std::vector<f32>(numParameters), NONE };
+
+  pad = {};
+  pad.output.resize(numParameters);
+}
+
+// NOTE(luca): has to run before the parameter listeners are attached, plug-in threads read the table
+// from the moment they can call us back
+void Engine::prepareWrites(u32 numParameters) {
+  JUCE_ASSERT_MESSAGE_THREAD
+
+  written = std::make_unique<std::atomic<f32>[]>(size_t(numParameters) * echoSlots);
+  writeCursors = std::make_unique<u8[]>(numParameters);
+  echoTolerances = std::make_unique<f32[]>(numParameters);
+
+  for (u32 i = 0; i < numParameters * echoSlots; ++i) {
+    written[i] = -1;
+  }
+
+  // NOTE(luca): stepped parameters report back the step they landed on, anything within half a step of
+  // a write is its echo
+  for (u32 i = 0; i < numParameters; ++i) {
+    i32 steps = manager.parameters[i].parameter->getNumSteps();
+    bool stepped = steps > 1 && steps != juce::AudioProcessor::getDefaultNumParameterSteps();
+    echoTolerances[i] = stepped ? std::max(echoTolerance, 0.5f / f32(steps - 1)) : echoTolerance;
+    writeCursors[i] = 0;
+  }
+
+  numWritten = numParameters;
+}
+
+void Engine::writeParameter(u32 i, f32 value) {
+  assert(i < numWritten);
+
+  ScopedWrite scope;
+  u8 slot = writeCursors[i]++ % echoSlots;
+  written[size_t(i) * echoSlots + slot].store(value, std::memory_order_relaxed);
+  manager.parameters[i].parameter->setValue(value);
+}
+
+bool Engine::isEcho(u32 i, f32 value) {
+  if (ScopedWrite::active) {
+    return true;
+  }
+
+  if (i >= numWritten) {
+    return false;
+  }
+
+  // NOTE(luca): the last few writes of every parameter are kept since plug-ins can report a write back
+  // after newer ones went out. Each write is matched by one echo at most and the others are left alone,
+  // so the user moving a parameter back to a value we wrote earlier still counts.
+  auto* slots = written.get() + size_t(i) * echoSlots;
+  f32 tolerance = echoTolerances[i];
+
+  for (u32 s = 0; s < echoSlots; ++s) {
+    f32 w = slots[s].load(std::memory_order_relaxed);
+
+    if (w >= 0 && std::abs(w - value) <= tolerance && slots[s].compare_exchange_strong(w, -1, std::memory_order_relaxed)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+const std::vector<f32>& Engine::expand(ExpandedClip& e, u32 clip) {
+  assert(clip < manager.clips.size());
+  assert(e.values.size() == manager.clips[clip].getNumParameters());
+
+  if (e.clip != i32(clip)) {
+    manager.clips[clip].expand(e.values.data());
+    e.clip = i32(clip);
+  }
 
-  instance->prepareToPlay(sampleRate, blockSize);
-  proc.setLatencySamples(instance->getLatencySamples());
+  return e.values;
 }
 
 void Engine::setParameters(const std::vector<f32>& preset, std::vector<Parameter>& parameters) {
@@ -18,7 +101,94 @@ void Engine::setParameters(const std::vector<f32>& preset, std::vector<Parameter
   for (u32 i = 0; i < parameters.size(); ++i) {
     if (manager.shouldProcessParameter(i)) {
       if (neqf32(parameters[i].parameter->getValue(), preset[i])) {
-        parameters[i].parameter->setValue(preset[i]);
+        writeParameter(i, preset[i]);
+      }
+    }
+  }
+}
+
+template <Curve C>
+static inline f32 shapePosition(f32 t) {
+  if constexpr (C == Curve::sCurve) {
+    return t * t * (3 - 2 * t);
+  } else if constexpr (C == Curve::step) {
+    return t < 0.5f ? 0.f : 1.f;
+  } else {
+    return t;
+  }
+}
+
+// NOTE(luca): exponential moves by a constant ratio rather than a constant amount. A ratio to zero doesn't
+// exist so with a zero end it eases quadratically out of zero instead, the ends are always hit exactly.
+template <Curve C>
+static inline f32 morph(f32 a, f32 b, f32 t) {
+  if constexpr (C == Curve::exponential) {
+    if (t <= 0) {
+      return a;
+    } else if (t >= 1) {
+      return b;
+    } else if (a <= 0) {
+      return b * t * t;
+    } else if (b <= 0) {
+      return a * (1 - t) * (1 - t);
+    }
+
+    return std::clamp(a * std::pow(b / a, t), 0.f, 1.f);
+  } else {
+    return a + (b - a) * t;
+  }
+}
+
+// NOTE(luca): position at which morphing from a to b gives v, every curve is monotonic so bisection is enough
+template <Curve C>
+static inline f32 unmorph(f32 a, f32 b, f32 v) {
+  f32 lo = 0;
+  f32 hi = 1;
+  bool rising = b > a;
+
+  for (u32 i = 0; i < 16; ++i) {
+    f32 p = (lo + hi) * 0.5f;
+
+    if ((morph<C>(a, b, shapePosition<C>(p)) < v) == rising) {
+      lo = p;
+    } else {
+      hi = p;
+    }
+  }
+
+  return (lo + hi) * 0.5f;
+}
+
+f32 Engine::unmorph(Curve curve, f32 a, f32 b, f32 v) {
+  switch (curve) {
+    case Curve::linear:      return atmt::unmorph<Curve::linear>(a, b, v);
+    case Curve::exponential: return atmt::unmorph<Curve::exponential>(a, b, v);
+    case Curve::sCurve:      return atmt::unmorph<Curve::sCurve>(a, b, v);
+    case Curve::step:        return atmt::unmorph<Curve::step>(a, b, v);
+  }
+
+  return 0;
+}
+
+// NOTE(luca): one instantiation per curve, parameters are grouped by curve so the loop never branches on it
+template <Curve C>
+void Engine::interpolateGroup(const std::vector<u32>& indices, const f32* begin, const f32* end, f32 position) {
+  auto& parameters = manager.parameters;
+  f32 t = shapePosition<C>(position);
+
+  for (u32 i : indices) {
+    if (parameters[i].active && manager.shouldProcessParameter(i)) {
+      assert(isNormalised(begin[i]));
+      assert(isNormalised(end[i]));
+
+      f32 newValue = morph<C>(begin[i], end[i], t);
+      assert(isNormalised(newValue));
+
+      writeParameter(i, newValue);
+
+      if (manager.uiParameterSync.mode == UIParameterSync::EngineUpdate) {
+        manager.uiParameterSync.values[i] = newValue;
+        manager.uiParameterSync.updates[i] = true;
       }
     }
   }
@@ -29,6 +199,11 @@ void Engine::interpolate() {
 
   assert(instance);
 
+  if (manager.padMode) {
+    blend();
+    return;
+  }
+
   f32 time = manager.playheadPosition;
   f32 lerpPos = getYFromX(manager.automation, time);
   assert(!(lerpPos > 1.f) && !(lerpPos < 0.f));
@@ -38,22 +213,28 @@ void Engine::interpolate() {
 
   assert(!clips.empty());
 
+  if (u32 generation = manager.clipGeneration; generation != expandedGeneration) {
+    expandedGeneration = generation;
+    expandedA.clip = NONE;
+    expandedB.clip = NONE;
+  }
+
   if (clips.size() == 1) {
     if (lastVisitedPair != FRONT_PAIR) {
       lastVisitedPair = FRONT_PAIR;
-      setParameters(clips.front().parameters, manager.parameters);
+      setParameters(expand(expandedA, 0), manager.parameters);
     }
   } else if (time < pairs.front().start) {
     if (lastVisitedPair != FRONT_PAIR) {
       lastVisitedPair = FRONT_PAIR;
-      setParameters(clips[pairs.front().a].parameters, manager.parameters);
+      setParameters(expand(expandedA, pairs.front().a), manager.parameters);
     }
   } else if (time > pairs.back().end) {
     assert(clips.size() == pairs.size() + 1);
 
     if (lastVisitedPair != BACK_PAIR) {
       lastVisitedPair = BACK_PAIR;
-      setParameters(clips[pairs.back().b].parameters, manager.parameters);
+      setParameters(expand(expandedB, pairs.back().b), manager.parameters);
     }
   } else {
     assert(clips.size() == pairs.size() + 1);
@@ -67,32 +248,25 @@ void Engine::interpolate() {
         a = pairs[pairIndex].a;
         b = pairs[pairIndex].b;
 
-        const auto& beginParameters = clips[a].parameters;
-        const auto& endParameters   = clips[b].parameters;
-        auto& parameters = manager.parameters;
-
-        if (pairs[pairIndex].interpolate) {
-          for (u32 parameterIndex = 0; parameterIndex < parameters.size(); ++parameterIndex) {
-            if (parameters[parameterIndex].active && (pairs[pairIndex].parameters[parameterIndex] || lastVisitedPair != i32(pairIndex))) {
-              if (manager.shouldProcessParameter(parameterIndex)) {
-                assert(isNormalised(beginParameters[parameterIndex]));
-                assert(isNormalised(endParameters[parameterIndex]));
+        // NOTE(luca): moving forward one pair the old end clip becomes the new start clip
+        if (expandedB.clip == i32(a)) {
+          std::swap(expandedA, expandedB);
+        }
 
-                f32 position = bool(clips[u32(a)].y) ? 1.f - lerpPos : lerpPos;
+        const auto* beginParameters = expand(expandedA, a).data();
+        const auto* endParameters   = expand(expandedB, b).data();
+        const auto& pair = pairs[pairIndex];
 
-                f32 increment = (endParameters[parameterIndex] - beginParameters[parameterIndex]) * position;
-                f32 newValue  = beginParameters[parameterIndex] + increment;
-                assert(isNormalised(newValue));
+        if (pair.interpolate) {
+          f32 position = bool(clips[u32(a)].y) ? 1.f - lerpPos : lerpPos;
 
-                parameters[parameterIndex].parameter->setValue(f32(newValue));
+          // NOTE(luca): entering a pair sets every parameter once, after that only the ones that differ move
+          const auto& lists = lastVisitedPair != i32(pairIndex) ? curveGroups : pair.changed;
 
-                if (manager.uiParameterSync.mode == UIParameterSync::EngineUpdate) {
-                  manager.uiParameterSync.values[parameterIndex] = f32(newValue);
-                  manager.uiParameterSync.updates[parameterIndex] = true;
-                }
-              }
-            }
-          }
+          interpolateGroup<Curve::linear>(lists[u32(Curve::linear)], beginParameters, endParameters, position);
+          interpolateGroup<Curve::exponential>(lists[u32(Curve::exponential)], beginParameters, endParameters, position);
+          interpolateGroup<Curve::sCurve>(lists[u32(Curve::sCurve)], beginParameters, endParameters, position);
+          interpolateGroup<Curve::step>(lists[u32(Curve::step)], beginParameters, endParameters, position);
         }
 
         lastVisitedPair = i32(pairIndex);
@@ -106,18 +280,242 @@ void Engine::interpolate() {
   }
 }
 
+// NOTE(luca): inverse distance weighting with power 2. A clip right under the cursor takes over completely
+// and clips whose share would be negligible are dropped so the blend only touches the rows that matter.
+void Engine::computePadWeights(const std::vector<juce::Point<f32>>& points, f32 x, f32 y, std::vector<f32>& weights, std::vector<u32>& contributors) {
+  u32 numClips = u32(points.size());
+  weights.assign(numClips, 0);
+  contributors.clear();
+
+  f32 sum = 0;
+
+  for (u32 i = 0; i < numClips; ++i) {
+    const auto& p = points[i];
+
+    if (p.x < 0 || p.y < 0) {
+      continue;
+    }
+
+    f32 dx = p.x - x;
+    f32 dy = p.y - y;
+    f32 d2 = dx * dx + dy * dy;
+
+    if (d2 < padSnapDistance * padSnapDistance) {
+      std::fill(weights.begin(), weights.end(), 0.f);
+      weights[i] = 1;
+      contributors.push_back(i);
+      return;
+    }
+
+    weights[i] = 1 / d2;
+    sum += weights[i];
+  }
+
+  if (sum <= 0) {
+    return;
+  }
+
+  f32 kept = 0;
+
+  for (u32 i = 0; i < numClips; ++i) {
+    if (weights[i] / sum >= padMinWeight) {
+      contributors.push_back(i);
+      kept += weights[i];
+    } else {
+      weights[i] = 0;
+    }
+  }
+
+  for (u32 i : contributors) {
+    weights[i] /= kept;
+  }
+}
+
+// NOTE(luca): output = sum of weights[i] * row i over the contributing rows. Each pass is a vectorised
+// multiply-add over one row, the output stays in cache between passes.
+void Engine::weightedSum(const f32* matrix, u32 numParameters, const f32* weights, const u32* rows, u32 numRows, f32* output) {
+  using Ops = juce::FloatVectorOperations;
+
+  if (numRows == 0) {
+    return;
+  }
+
+  auto n = i32(numParameters);
+
+  Ops::multiply(output, matrix + size_t(rows[0]) * numParameters, weights[rows[0]], n);
+
+  for (u32 i = 1; i < numRows; ++i) {
+    Ops::addWithMultiply(output, matrix + size_t(rows[i]) * numParameters, weights[rows[i]], n);
+  }
+
+  Ops::clip(output, output, 0.f, 1.f, n);
+}
+
+// NOTE(luca): the pad matrix is built on the message thread with processing suspended, blend only reads
+// it. Everything blend resizes is sized here so the audio thread never allocates.
+void Engine::buildPadMatrix() {
+  JUCE_ASSERT_MESSAGE_THREAD
+
+  ScopedProcLock lk(proc);
+
+  const auto& clips = manager.clips;
+  u32 numClips = u32(clips.size());
+  u32 numParameters = u32(manager.parameters.size());
+
+  pad.matrix.resize(size_t(numClips) * numParameters);
+  pad.points.resize(numClips);
+  pad.weights.resize(numClips);
+  pad.contributors.reserve(numClips);
+
+  for (u32 i = 0; i < numClips; ++i) {
+    clips[i].expand(pad.matrix.data() + size_t(i) * numParameters);
+    pad.points[i] = { clips[i].padX, clips[i].padY };
+  }
+
+  pad.dirty = true;
+}
+
+void Engine::updatePadRow(u32 clip) {
+  JUCE_ASSERT_MESSAGE_THREAD
+
+  const auto& clips = manager.clips;
+  u32 numParameters = u32(manager.parameters.size());
+
+  if (clip >= pad.points.size() || pad.matrix.size() != clips.size() * numParameters) {
+    return;
+  }
+
+  ScopedProcLock lk(proc);
+
+  clips[clip].expand(pad.matrix.data() + size_t(clip) * numParameters);
+  pad.points[clip] = { clips[clip].padX, clips[clip].padY };
+  pad.dirty = true;
+}
+
+void Engine::blend() {
+  //scoped_timer t("Engine::blend()");
+
+  const auto& clips = manager.clips;
+  auto& parameters = manager.parameters;
+
+  u32 numClips = u32(clips.size());
+  u32 numParameters = u32(parameters.size());
+
+  assert(numClips > 0);
+  assert(pad.output.size() == numParameters);
+
+  // NOTE(luca): the message thread hasn't caught up with the clips yet
+  if (pad.points.size() != numClips || pad.matrix.size() != size_t(numClips) * numParameters) {
+    return;
+  }
+
+  bool changed = std::exchange(pad.dirty, false) || lastVisitedPair != PAD_PAIR;
+
+  f32 x = manager.padX->get();
+  f32 y = manager.padY->get();
+
+  if (neqf32(x, pad.x) || neqf32(y, pad.y)) {
+    pad.x = x;
+    pad.y = y;
+    changed = true;
+  }
+
+  if (!changed) {
+    return;
+  }
+
+  computePadWeights(pad.points, x, y, pad.weights, pad.contributors);
+
+  if (pad.contributors.empty()) {
+    return;
+  }
+
+  weightedSum(pad.matrix.data(), numParameters, pad.weights.data(), pad.contributors.data(), u32(pad.contributors.size()), pad.output.data());
+
+  for (u32 i = 0; i < numParameters; ++i) {
+    if (parameters[i].active && manager.shouldProcessParameter(i)) {
+      f32 value = pad.output[i];
+
+      if (neqf32(parameters[i].parameter->getValue(), value)) {
+        writeParameter(i, value);
+
+        if (manager.uiParameterSync.mode == UIParameterSync::EngineUpdate) {
+          manager.uiParameterSync.values[i] = value;
+          manager.uiParameterSync.updates[i] = true;
+        }
+      }
+    }
+  }
+
+  lastVisitedPair = PAD_PAIR;
+
+  if (manager.uiParameterSync.mode == UIParameterSync::EngineUpdate) {
+    manager.uiParameterSync.mode = UIParameterSync::UIUpdate;
+  }
+}
+
+// NOTE(luca): the parameter being recorded is projected onto the pair under the playhead, the lane value
+// is whatever position of that pair would produce the parameter's current value
+void Engine::record(u32 parameter) {
+  const auto& clips = manager.clips;
+  const auto& pairs = lerpPairs;
+  f32 time = manager.playheadPosition;
+
+  // NOTE(luca): the engine doesn't drive the plug-in while a take is recorded, everything is set again after
+  lastVisitedPair = UNDEFINED_PAIR;
+
+  if (parameter >= manager.parameters.size() || clips.size() < 2) {
+    return;
+  }
+
+  if (u32 generation = manager.clipGeneration; generation != expandedGeneration) {
+    expandedGeneration = generation;
+    expandedA.clip = NONE;
+    expandedB.clip = NONE;
+  }
+
+  for (const auto& pair : pairs) {
+    if (time >= pair.start && time <= pair.end) {
+      if (!pair.interpolate) {
+        return;
+      }
+
+      if (expandedB.clip == i32(pair.a)) {
+        std::swap(expandedA, expandedB);
+      }
+
+      f32 a = expand(expandedA, pair.a)[parameter];
+      f32 b = expand(expandedB, pair.b)[parameter];
+
+      if (!neqf32(a, b)) {
+        return;
+      }
+
+      f32 value = manager.parameters[parameter].parameter->getValue();
+      f32 position = unmorph(manager.parameters[parameter].curve, a, b, value);
+      manager.recorder.push(time, bool(clips[pair.a].y) ? 1.f - position : position);
+      return;
+    }
+  }
+}
+
 void Engine::process(juce::AudioBuffer<f32>& buffer, juce::MidiBuffer& midiBuffer) {
-  assert(instance);
+  auto* p = instance.load();
+  assert(p);
 
   if (!manager.editMode && !manager.clips.empty()) {
-    interpolate();
+    if (i32 recording = manager.recordParameter; recording != NONE) {
+      record(u32(recording));
+    } else {
+      interpolate();
+    }
   }
 
-  if (buffer.getNumChannels() < instance->getTotalNumInputChannels()) {
-    buffer.setSize(instance->getTotalNumInputChannels(), buffer.getNumSamples(), true, false, true);
+  if (buffer.getNumChannels() < p->getTotalNumInputChannels()) {
+    buffer.setSize(p->getTotalNumInputChannels(), buffer.getNumSamples(), true, false, true);
   }
 
-  instance->processBlock(buffer, midiBuffer);
+  p->processBlock(buffer, midiBuffer);
 }
 
 } // namespace atmt
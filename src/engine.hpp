@@ -4,27 +4,88 @@
 #include "state_manager.hpp"
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <juce_audio_devices/juce_audio_devices.h>
+#include <array>
 
 #define UNDEFINED_PAIR -3
 #define FRONT_PAIR -2
 #define BACK_PAIR -1
+#define PAD_PAIR -4
 
 namespace atmt {
 
 struct Engine  {
+  // NOTE(luca): dense copy of a sparse clip, only the two clips of the current pair are expanded
+  struct ExpandedClip {
+    std::vector<f32> values;
+    i32 clip = NONE;
+  };
+
+  // NOTE(luca): dense copy of every clip for the xy pad, one row per clip
+  struct PadBlend {
+    std::vector<f32> matrix;
+    std::vector<juce::Point<f32>> points;
+    std::vector<f32> weights;
+    std::vector<u32> contributors;
+    std::vector<f32> output;
+    bool dirty = true;
+    f32 x = -1;
+    f32 y = -1;
+  };
+
+  // NOTE(luca): hosted plug-ins call their listeners back when we set a value, sometimes from inside setValue
+  // and sometimes later from their own threads. The first kind is caught by the write scope, the second by
+  // comparing against the last few values the engine wrote.
+  struct ScopedWrite {
+    ScopedWrite() { active = true; }
+    ~ScopedWrite() { active = false; }
+
+    static inline thread_local bool active = false;
+  };
+
   Engine(StateManager&);
 
   void prepare(f32, i32);
+  void prepareBuffers(u32);
+  void prepareWrites(u32);
+  const std::vector<f32>& expand(ExpandedClip&, u32);
   void setParameters(const std::vector<f32>&, std::vector<Parameter>&);
+  void writeParameter(u32, f32);
+  bool isEcho(u32, f32);
   void interpolate();
+  template <Curve C> void interpolateGroup(const std::vector<u32>&, const f32*, const f32*, f32);
+  void buildPadMatrix();
+  void updatePadRow(u32);
+  void blend();
+  void record(u32);
+  static f32 unmorph(Curve, f32, f32, f32);
+  static void computePadWeights(const std::vector<juce::Point<f32>>&, f32, f32, std::vector<f32>&, std::vector<u32>&);
+  static void weightedSum(const f32*, u32, const f32*, const u32*, u32, f32*);
   void process(juce::AudioBuffer<f32>&, juce::MidiBuffer&);
 
   StateManager& manager;
   juce::AudioProcessor& proc { manager.proc };
-  juce::AudioProcessor* instance = nullptr;
+  std::atomic<juce::AudioProcessor*> instance = nullptr;
 
   std::vector<LerpPair> lerpPairs;
   i32 lastVisitedPair = UNDEFINED_PAIR;
+  std::array<std::vector<u32>, kNumCurves> curveGroups;
+
+  ExpandedClip expandedA;
+  ExpandedClip expandedB;
+  u32 expandedGeneration = 0;
+
+  PadBlend pad;
+
+  // NOTE(luca): echoSlots recent writes per parameter, the cursors are only touched by whoever writes
+  std::unique_ptr<std::atomic<f32>[]> written;
+  std::unique_ptr<u8[]> writeCursors;
+  std::unique_ptr<f32[]> echoTolerances;
+  u32 numWritten = 0;
+
+  static constexpr u32 echoSlots = 8;
+  static constexpr f32 echoTolerance = 1e-3f;
+  static constexpr f32 padSnapDistance = 0.02f;
+  static constexpr f32 padMinWeight = 1e-3f;
 };
 
 } // namespace atmt
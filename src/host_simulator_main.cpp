@@ -0,0 +1,279 @@
+#include "juce_build.cpp"
+#include "simulated_instance.hpp"
+#include <barrier>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <thread>
+
+#if JUCE_LINUX
+#include <unistd.h>
+#elif JUCE_MAC
+#include <mach/mach.h>
+#endif
+
+// NOTE(luca): soak test for projects with many Automate instances. Every instance hosts a simulated
+// plug-in and has a populated track, a pool of threads processes all of them once per host callback the
+// way a DAW spreads tracks over its audio threads. Between callbacks the block size changes, the playhead
+// jumps, loops and the tempo moves. Audio is processed as fast as possible, each callback is still
+// compared against the deadline it would have in real time.
+//
+// Usage: Automate-HostSimulator [instances] [threads] [seconds] [parameters]
+
+namespace atmt {
+
+struct SimulatedPlayHead : juce::AudioPlayHead {
+  juce::Optional<PositionInfo> getPosition() const override {
+    PositionInfo info;
+    info.setIsPlaying(true);
+    info.setPpqPosition(ppq);
+    info.setBpm(bpm);
+    info.setTimeSignature(TimeSignature { 4, 4 });
+    info.setIsLooping(looping);
+    info.setLoopPoints(LoopPoints { loopStart, loopEnd });
+    return info;
+  }
+
+  // NOTE(luca): only written between callbacks, the barriers order it with the audio threads
+  f64 ppq = 0;
+  f64 bpm = 120;
+  bool looping = false;
+  f64 loopStart = 8;
+  f64 loopEnd = 24;
+};
+
+struct HostSimulator {
+  using clock = std::chrono::steady_clock;
+
+  struct Worker {
+    juce::AudioBuffer<f32> buffer;
+    juce::MidiBuffer midi;
+    f64 busy = 0;
+    f64 worst = 0;
+  };
+
+  HostSimulator(u32 instances, u32 threads, f64 seconds, u32 parameters)
+    : numInstances(instances), numThreads(threads), duration(seconds), numParameters(parameters),
+      start(std::ptrdiff_t(threads) + 1), finish(std::ptrdiff_t(threads) + 1) {}
+
+  bool run() {
+    i64 baseMemory = getResidentBytes();
+
+    for (u32 i = 0; i < numInstances; ++i) {
+      auto plugin = std::make_unique<Plugin>();
+      auto& m = plugin->manager;
+
+      m.installPlugin(std::make_unique<SimulatedInstance>(numParameters), sampleRate, maxBlockSize);
+
+      // NOTE(luca): nothing pumps the message loop here so the autosave timer would never fire anyway
+      m.journal.stop();
+
+      populateTrack(m, numPoints, rng);
+      m.setEditMode(false);
+
+      plugin->setPlayHead(&playhead);
+      plugin->prepareToPlay(sampleRate, maxBlockSize);
+      plugins.push_back(std::move(plugin));
+    }
+
+    i64 instanceMemory = getResidentBytes() - baseMemory;
+
+    juce::AudioBuffer<f32> noise(numChannels, maxBlockSize);
+    juce::Random random(1);
+
+    for (i32 c = 0; c < numChannels; ++c) {
+      for (i32 s = 0; s < maxBlockSize; ++s) {
+        noise.setSample(c, s, random.nextFloat() * 2 - 1);
+      }
+    }
+
+    workers.resize(numThreads);
+
+    for (auto& w : workers) {
+      w.buffer.makeCopyOf(noise);
+      w.midi.ensureSize(256);
+    }
+
+    std::vector<std::thread> threads;
+
+    for (u32 t = 0; t < numThreads; ++t) {
+      threads.emplace_back([this, t, &noise] { work(t, noise); });
+    }
+
+    f64 simulated = 0;
+    f64 processing = 0;
+    f64 worstCycle = 0;
+    f64 worstLoad = 0;
+    u64 cycles = 0;
+    u64 misses = 0;
+
+    std::clock_t cpuStart = std::clock();
+
+    while (simulated < duration) {
+      blockSize = kBlockSizes[rng() % kBlockSizes.size()];
+      advanceTransport();
+
+      next = 0;
+
+      auto t0 = clock::now();
+      start.arrive_and_wait();
+      finish.arrive_and_wait();
+      f64 elapsed = std::chrono::duration<f64>(clock::now() - t0).count();
+
+      f64 deadline = f64(blockSize) / sampleRate;
+      simulated += deadline;
+      processing += elapsed;
+      worstCycle = std::max(worstCycle, elapsed);
+      worstLoad = std::max(worstLoad, elapsed / deadline);
+      misses += elapsed > deadline;
+      ++cycles;
+    }
+
+    f64 cpu = f64(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+
+    done = true;
+    start.arrive_and_wait();
+
+    for (auto& t : threads) {
+      t.join();
+    }
+
+    f64 busy = 0;
+    f64 worstBlock = 0;
+
+    for (const auto& w : workers) {
+      busy += w.busy;
+      worstBlock = std::max(worstBlock, w.worst);
+    }
+
+    std::printf("%u instances, %u threads, %u parameters, %.0f s of audio in %llu callbacks\n", numInstances, numThreads, numParameters, simulated, (unsigned long long) cycles);
+    std::printf("processing took %.2f s, %.1f%% of real time\n", processing, 100 * processing / simulated);
+    std::printf("cpu time %.2f s, %.1f%% of one core per second of audio\n", cpu, 100 * cpu / simulated);
+    std::printf("time inside processBlock %.2f s, %.1f us per instance per callback\n", busy, 1e6 * busy / f64(cycles * numInstances));
+    std::printf("worst callback %.3f ms, %.1f%% of its deadline, %llu over deadline\n", worstCycle * 1e3, 100 * worstLoad, (unsigned long long) misses);
+    std::printf("worst single processBlock %.3f ms\n", worstBlock * 1e3);
+
+    if (instanceMemory > 0) {
+      std::printf("memory %s per instance\n", juce::File::descriptionOfSizeInBytes(instanceMemory / i64(numInstances)).toRawUTF8());
+    }
+
+    // NOTE(luca): every write is echoed back late by the simulated plug-in, none of them may look like a
+    // user change
+    u64 leaked = 0;
+
+    for (auto& p : plugins) {
+      p->manager.pendingParameterChanges.drain([&] (u32) { ++leaked; });
+    }
+
+    std::printf("parameters with leaked echoes %llu\n", (unsigned long long) leaked);
+
+    plugins.clear();
+    return leaked == 0;
+  }
+
+  void work(u32 thread, const juce::AudioBuffer<f32>& noise) {
+    auto& w = workers[thread];
+
+    while (true) {
+      start.arrive_and_wait();
+
+      if (done) {
+        return;
+      }
+
+      for (u32 i = next++; i < numInstances; i = next++) {
+        for (i32 c = 0; c < numChannels; ++c) {
+          w.buffer.copyFrom(c, 0, noise, c, 0, blockSize);
+        }
+
+        juce::AudioBuffer<f32> block(w.buffer.getArrayOfWritePointers(), numChannels, blockSize);
+        w.midi.clear();
+
+        auto t0 = clock::now();
+        plugins[i]->processBlock(block, w.midi);
+        f64 elapsed = std::chrono::duration<f64>(clock::now() - t0).count();
+
+        w.busy += elapsed;
+        w.worst = std::max(w.worst, elapsed);
+      }
+
+      finish.arrive_and_wait();
+    }
+  }
+
+  void advanceTransport() {
+    playhead.ppq += f64(blockSize) / sampleRate * playhead.bpm / 60;
+
+    if (playhead.looping && playhead.ppq >= playhead.loopEnd) {
+      playhead.ppq = playhead.loopStart + std::fmod(playhead.ppq - playhead.loopEnd, playhead.loopEnd - playhead.loopStart);
+    }
+
+    u32 roll = rng() % 1000;
+
+    if (roll < 2) {
+      playhead.ppq = std::uniform_real_distribution<f64>(0, f64(numPoints))(rng);
+    } else if (roll < 4) {
+      playhead.bpm = std::uniform_real_distribution<f64>(60, 180)(rng);
+    } else if (roll < 5) {
+      playhead.looping = !playhead.looping;
+    }
+
+    if (playhead.ppq > f64(numPoints)) {
+      playhead.ppq = 0;
+    }
+  }
+
+  static i64 getResidentBytes() {
+#if JUCE_LINUX
+    auto fields = juce::StringArray::fromTokens(juce::File("/proc/self/statm").loadFileAsString(), false);
+    return fields[1].getLargeIntValue() * i64(sysconf(_SC_PAGESIZE));
+#elif JUCE_MAC
+    mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t) &info, &count) == KERN_SUCCESS) {
+      return i64(info.resident_size);
+    }
+
+    return 0;
+#else
+    return 0;
+#endif
+  }
+
+  static constexpr std::array<i32, 5> kBlockSizes { 64, 128, 256, 512, 1024 };
+  static constexpr i32 maxBlockSize = 1024;
+  static constexpr i32 numChannels = 4;
+  static constexpr f64 sampleRate = 48000;
+  static constexpr u32 numPoints = 64;
+
+  u32 numInstances = 0;
+  u32 numThreads = 0;
+  f64 duration = 0;
+  u32 numParameters = 0;
+
+  std::vector<std::unique_ptr<Plugin>> plugins;
+  std::vector<Worker> workers;
+  SimulatedPlayHead playhead;
+
+  std::barrier<> start;
+  std::barrier<> finish;
+  std::atomic<u32> next = 0;
+  std::atomic<bool> done = false;
+  i32 blockSize = 512;
+
+  std::mt19937 rng { 1 };
+};
+
+} // namespace atmt
+
+int main(int argc, char* argv[]) {
+  juce::ScopedJuceInitialiser_GUI init;
+
+  u32 instances  = argc > 1 ? u32(std::atoi(argv[1])) : 48;
+  u32 threads    = argc > 2 ? u32(std::atoi(argv[2])) : std::max(2u, std::thread::hardware_concurrency()) - 1;
+  f64 seconds    = argc > 3 ? std::atof(argv[3]) : 60;
+  u32 parameters = argc > 4 ? u32(std::atoi(argv[4])) : 512;
+
+  return atmt::HostSimulator(instances, std::max(threads, 1u), seconds, parameters).run() ? 0 : 1;
+}
@@ -0,0 +1,588 @@
+#include "journal.hpp"
+#include "utils.hpp"
+#include "logger.hpp"
+
+namespace atmt {
+
+static_assert(sizeof(Path) == sizeof(f32) * 3);
+
+// NOTE(luca): InterProcessLock is per process on some platforms, so journals owned by other instances
+// living in this process are tracked here
+static juce::CriticalSection liveJournalsLock;
+static juce::StringArray liveJournals;
+
+static const std::vector<f32>* getBase(const Document& d) {
+  if (d.clips.chunks.empty()) {
+    return nullptr;
+  }
+
+  return d.clips.chunks.front()->front().base.get();
+}
+
+static void writeRecord(juce::OutputStream& out, i32 type, const juce::MemoryBlock& payload) {
+  out.writeInt(type);
+  out.writeInt64(i64(payload.getSize()));
+  out << payload;
+}
+
+Journal::Journal() : juce::Thread("Automate Journal") {
+  startThread(juce::Thread::Priority::background);
+}
+
+Journal::~Journal() {
+  stopTimer();
+  signalThreadShouldExit();
+  notify();
+  stopThread(5000);
+
+  out.reset();
+
+  if (file != juce::File()) {
+    file.deleteFile();
+  }
+
+  const juce::ScopedLock sl(liveJournalsLock);
+  liveJournals.removeString(id);
+}
+
+void Journal::start(const Document& d) {
+  JUCE_ASSERT_MESSAGE_THREAD
+
+  if (file == juce::File()) {
+    FilePath::autosave.createDirectory();
+    file = FilePath::autosave.getChildFile(id + ".journal");
+
+    ownerLock = std::make_unique<juce::InterProcessLock>("Automate-" + id);
+    ownerLock->enter(0);
+
+    const juce::ScopedLock sl(liveJournalsLock);
+    liveJournals.add(id);
+  }
+
+  metaGeneration = settingsGeneration = captureGeneration();
+  ticksSinceMeta = 0;
+  auto meta = captureMeta();
+
+  {
+    const juce::ScopedLock sl(lock);
+    active = true;
+    pending = d;
+    pendingMeta = std::move(meta);
+    pendingSettings.reset();
+  }
+
+  startTimer(writeIntervalMs);
+  notify();
+}
+
+void Journal::stop() {
+  JUCE_ASSERT_MESSAGE_THREAD
+
+  stopTimer();
+
+  const juce::ScopedLock sl(lock);
+  active = false;
+  discard = true;
+  pending.reset();
+  pendingMeta.reset();
+  pendingSettings.reset();
+}
+
+void Journal::push(const Document& d) {
+  JUCE_ASSERT_MESSAGE_THREAD
+
+  const juce::ScopedLock sl(lock);
+
+  if (active) {
+    pending = d;
+  }
+}
+
+void Journal::timerCallback() {
+  // NOTE(luca): nothing is captured unless something changed. Settings go out with the next delta, the
+  // plug-in's state is only asked for every snapshotIntervalMs. Read before capturing so a change halfway
+  // through is picked up next time.
+  u64 generation = captureGeneration();
+  ++ticksSinceMeta;
+
+  std::optional<Settings> settings;
+  std::optional<Meta> meta;
+
+  if (generation != settingsGeneration) {
+    settingsGeneration = generation;
+    settings = captureSettings();
+  }
+
+  if (generation != metaGeneration && ticksSinceMeta * writeIntervalMs >= snapshotIntervalMs) {
+    metaGeneration = generation;
+    ticksSinceMeta = 0;
+    meta = captureMeta();
+  }
+
+  if (!settings && !meta) {
+    return;
+  }
+
+  const juce::ScopedLock sl(lock);
+
+  if (active) {
+    if (settings) {
+      pendingSettings = std::move(settings);
+    }
+
+    if (meta) {
+      pendingMeta = std::move(meta);
+    }
+  }
+}
+
+void Journal::run() {
+  while (!threadShouldExit()) {
+    wait(writeIntervalMs);
+
+    std::optional<Document> d;
+    std::optional<Meta> meta;
+    std::optional<Settings> settings;
+    bool isActive = false;
+    bool shouldDiscard = false;
+
+    {
+      const juce::ScopedLock sl(lock);
+      d.swap(pending);
+      meta.swap(pendingMeta);
+      settings.swap(pendingSettings);
+      isActive = active;
+      shouldDiscard = std::exchange(discard, false);
+    }
+
+    if (shouldDiscard) {
+      out.reset();
+      file.deleteFile();
+      written = {};
+      writtenMeta = {};
+      deltasSinceSnapshot = 0;
+    }
+
+    if (!isActive) {
+      continue;
+    }
+
+    if (d || settings) {
+      const Document& next = d ? *d : written;
+
+      if (out == nullptr || getBase(next) != getBase(written)) {
+        if (meta) {
+          writtenMeta = std::move(*meta);
+          meta.reset();
+        }
+
+        if (settings) {
+          writtenMeta.settings = std::move(*settings);
+        }
+
+        writeSnapshot(next);
+      } else {
+        writeDelta(next, settings);
+      }
+    }
+
+    // NOTE(luca): compaction, only worth doing when something changed since the last snapshot
+    if (meta && (deltasSinceSnapshot > 0 || meta->pluginData != writtenMeta.pluginData)) {
+      writtenMeta = std::move(*meta);
+      writeSnapshot(written);
+    }
+  }
+}
+
+void Journal::writeSnapshot(const Document& d) {
+  Session session;
+  toSession(d, writtenMeta, session);
+
+  juce::MemoryBlock payload;
+
+  {
+    juce::MemoryOutputStream r(payload, false);
+    auto* base = getBase(d);
+
+    r.writeInt(base ? i32(base->size()) : 0);
+
+    if (base) {
+      r.write(base->data(), base->size() * sizeof(f32));
+    }
+
+    juce::MemoryBlock sessionData;
+    session.write(sessionData);
+    r << sessionData;
+  }
+
+  out.reset();
+
+  juce::TemporaryFile temp(file);
+
+  {
+    juce::FileOutputStream o(temp.getFile());
+
+    if (o.failedToOpen()) {
+      Logger::error("Failed to open " + temp.getFile().getFullPathName());
+      return;
+    }
+
+    o.writeInt(magic);
+    o.writeInt(version);
+    writeRecord(o, snapshotRecord, payload);
+    o.flush();
+  }
+
+  if (!temp.overwriteTargetFileWithTemporary()) {
+    Logger::error("Failed to write " + file.getFullPathName());
+    return;
+  }
+
+  out = std::make_unique<juce::FileOutputStream>(file);
+  written = d;
+  deltasSinceSnapshot = 0;
+}
+
+static void writeSettings(juce::OutputStream& out, const Journal::Settings& s) {
+  out.writeFloat(s.zoom);
+  out.writeBool(s.editMode);
+  out.writeBool(s.discreteMode);
+  out.writeBool(s.padMode);
+  out.writeFloat(s.padX);
+  out.writeFloat(s.padY);
+  out.writeInt(i32(s.parameterQuantized.size()));
+  out.write(s.parameterQuantized.data(), s.parameterQuantized.size());
+  out.writeInt(i32(s.parameterCurves.size()));
+  out.write(s.parameterCurves.data(), s.parameterCurves.size());
+}
+
+static void readSettings(juce::InputStream& in, Session& session) {
+  session.zoom = in.readFloat();
+  session.editMode = in.readBool();
+  session.discreteMode = in.readBool();
+  session.padMode = in.readBool();
+  session.padX = in.readFloat();
+  session.padY = in.readFloat();
+
+  session.parameterQuantized.resize(u32(std::max(in.readInt(), 0)));
+  in.read(session.parameterQuantized.data(), i32(session.parameterQuantized.size()));
+  session.parameterQuantized.resize(session.numParameters, 0);
+
+  session.parameterCurves.resize(u32(std::max(in.readInt(), 0)));
+  in.read(session.parameterCurves.data(), i32(session.parameterCurves.size()));
+  session.parameterCurves.resize(session.numParameters, 0);
+}
+
+void Journal::writeDelta(const Document& d, const std::optional<Settings>& settings) {
+  assert(out);
+
+  auto changed = [] (const auto& next, const auto& prev) {
+    std::vector<u32> result;
+
+    for (u32 c = 0; c < next.chunks.size(); ++c) {
+      if (c >= prev.chunks.size() || next.chunks[c] != prev.chunks[c]) {
+        result.push_back(c);
+      }
+    }
+
+    return result;
+  };
+
+  auto clipChunks = changed(d.clips, written.clips);
+  auto pathChunks = changed(d.paths, written.paths);
+  bool activeChanged = d.active != written.active && d.active;
+  bool settingsChanged = settings && !(*settings == writtenMeta.settings);
+
+  if (clipChunks.empty() && pathChunks.empty() && !activeChanged && !settingsChanged && d.quantizeClips == written.quantizeClips
+      && d.clips.size == written.clips.size && d.paths.size == written.paths.size) {
+    return;
+  }
+
+  juce::MemoryBlock payload;
+
+  {
+    juce::MemoryOutputStream r(payload, false);
+
+    r.writeInt(i32(d.clips.size));
+    r.writeInt(i32(d.paths.size));
+
+    r.writeInt(i32(clipChunks.size()));
+
+    for (u32 c : clipChunks) {
+      const auto& chunk = *d.clips.chunks[c];
+      r.writeInt(i32(c));
+      r.writeInt(i32(chunk.size()));
+
+      for (const auto& clip : chunk) {
+        r.writeFloat(clip.x);
+        r.writeFloat(clip.y);
+        r.writeFloat(clip.c);
+        r.writeFloat(clip.padX);
+        r.writeFloat(clip.padY);
+        r.writeInt(i32(clip.indices.size()));
+        r.write(clip.indices.data(), clip.indices.size() * sizeof(u32));
+        r.write(clip.values.data(), clip.values.size() * sizeof(f32));
+        r.writeInt(i32(clip.quantizedIndices.size()));
+        r.write(clip.quantizedIndices.data(), clip.quantizedIndices.size() * sizeof(u16));
+        r.write(clip.quantizedValues.data(), clip.quantizedValues.size() * sizeof(u16));
+      }
+    }
+
+    r.writeInt(i32(pathChunks.size()));
+
+    for (u32 c : pathChunks) {
+      const auto& chunk = *d.paths.chunks[c];
+      r.writeInt(i32(c));
+      r.writeInt(i32(chunk.size()));
+      r.write(chunk.data(), chunk.size() * sizeof(Path));
+    }
+
+    r.writeBool(activeChanged);
+
+    if (activeChanged) {
+      r.writeInt(i32(d.active->size()));
+
+      for (bool a : *d.active) {
+        r.writeBool(a);
+      }
+    }
+
+    r.writeBool(d.quantizeClips);
+    r.writeBool(settingsChanged);
+
+    if (settingsChanged) {
+      writeSettings(r, *settings);
+    }
+  }
+
+  writeRecord(*out, deltaRecord, payload);
+  out->flush();
+
+  if (settingsChanged) {
+    writtenMeta.settings = *settings;
+  }
+
+  written = d;
+  ++deltasSinceSnapshot;
+}
+
+void Journal::toSession(const Document& d, const Meta& meta, Session& session) {
+  session.pluginID = meta.pluginID;
+  session.pluginData = meta.pluginData;
+  session.zoom = meta.settings.zoom;
+  session.editMode = meta.settings.editMode;
+  session.discreteMode = meta.settings.discreteMode;
+  session.quantizeClips = d.quantizeClips;
+  session.padMode = meta.settings.padMode;
+  session.padX = meta.settings.padX;
+  session.padY = meta.settings.padY;
+  session.numParameters = u32(meta.parameterNames.size());
+  session.parameterNames = meta.parameterNames;
+  session.parameterQuantized = meta.settings.parameterQuantized;
+  session.parameterQuantized.resize(session.numParameters, 0);
+  session.parameterCurves = meta.settings.parameterCurves;
+  session.parameterCurves.resize(session.numParameters, 0);
+
+  session.clips.clear();
+  session.clips.reserve(d.clips.size);
+  session.padPoints.clear();
+  session.padPoints.reserve(d.clips.size);
+  session.clipParameters.assign(size_t(d.clips.size) * session.numParameters, 0);
+
+  for (const auto& chunk : d.clips.chunks) {
+    for (const auto& clip : *chunk) {
+      if (clip.getNumParameters() == session.numParameters) {
+        clip.expand(session.clipParameters.data() + session.clips.size() * session.numParameters);
+      }
+
+      session.clips.push_back({ clip.x, clip.y, clip.c });
+      session.padPoints.push_back({ clip.padX, clip.padY });
+    }
+  }
+
+  session.paths.clear();
+  session.paths.reserve(d.paths.size);
+
+  for (const auto& chunk : d.paths.chunks) {
+    for (const auto& p : *chunk) {
+      session.paths.push_back({ p.x, p.y, p.c });
+    }
+  }
+
+  session.parameterActive.assign(session.numParameters, 1);
+
+  if (d.active) {
+    for (u32 i = 0; i < session.numParameters && i < d.active->size(); ++i) {
+      session.parameterActive[i] = (*d.active)[i];
+    }
+  }
+}
+
+std::vector<juce::File> Journal::findOrphans() {
+  std::vector<juce::File> orphans;
+
+  for (const auto& f : FilePath::autosave.findChildFiles(juce::File::findFiles, false, "*.journal")) {
+    auto name = f.getFileNameWithoutExtension();
+
+    {
+      const juce::ScopedLock sl(liveJournalsLock);
+
+      if (liveJournals.contains(name)) {
+        continue;
+      }
+    }
+
+    juce::InterProcessLock owner("Automate-" + name);
+
+    if (owner.enter(0)) {
+      orphans.push_back(f);
+      owner.exit();
+    }
+  }
+
+  std::sort(orphans.begin(), orphans.end(), [] (const juce::File& a, const juce::File& b) {
+    return a.getLastModificationTime() > b.getLastModificationTime();
+  });
+
+  return orphans;
+}
+
+bool Journal::recover(const juce::File& f, Session& session) {
+  juce::FileInputStream in(f);
+
+  if (in.failedToOpen() || in.readInt() != magic || in.readInt() != version) {
+    return false;
+  }
+
+  std::vector<f32> base;
+  bool haveSnapshot = false;
+
+  while (!in.isExhausted()) {
+    i32 type = in.readInt();
+    i64 size = in.readInt64();
+
+    // NOTE(luca): a torn write at the end of the journal, everything before it is still good
+    if (size < 0 || in.getNumBytesRemaining() < size) {
+      break;
+    }
+
+    juce::MemoryBlock payload;
+    in.readIntoMemoryBlock(payload, size);
+    juce::MemoryInputStream r(payload, false);
+
+    if (type == snapshotRecord) {
+      base.resize(u32(std::max(r.readInt(), 0)));
+      r.read(base.data(), i32(base.size() * sizeof(f32)));
+
+      auto offset = size_t(r.getPosition());
+      haveSnapshot = session.read(static_cast<const char*>(payload.getData()) + offset, payload.getSize() - offset);
+    } else if (type == deltaRecord && haveSnapshot) {
+      u32 numParameters = session.numParameters;
+      u32 numClips = u32(r.readInt());
+      u32 numPaths = u32(r.readInt());
+
+      session.clips.resize(numClips);
+      session.padPoints.resize(numClips);
+      session.clipParameters.resize(size_t(numClips) * numParameters);
+      session.paths.resize(numPaths);
+
+      std::vector<u32> indices;
+      std::vector<f32> values;
+      std::vector<u16> quantizedIndices;
+      std::vector<u16> quantized;
+
+      i32 numClipChunks = r.readInt();
+
+      for (i32 i = 0; i < numClipChunks && !r.isExhausted(); ++i) {
+        u32 c = u32(r.readInt());
+        u32 count = u32(r.readInt());
+
+        for (u32 k = 0; k < count; ++k) {
+          u32 index = c * PersistentVector<Clip>::chunkSize + k;
+          Session::Point p;
+          p.x = r.readFloat();
+          p.y = r.readFloat();
+          p.c = r.readFloat();
+
+          Session::PadPoint pad;
+          pad.x = r.readFloat();
+          pad.y = r.readFloat();
+
+          indices.resize(u32(std::max(r.readInt(), 0)));
+          values.resize(indices.size());
+          r.read(indices.data(), i32(indices.size() * sizeof(u32)));
+          r.read(values.data(), i32(values.size() * sizeof(f32)));
+
+          if (index >= numClips || base.size() != numParameters) {
+            quantizedIndices.resize(u32(std::max(r.readInt(), 0)));
+            quantized.resize(quantizedIndices.size());
+            r.read(quantizedIndices.data(), i32(quantizedIndices.size() * sizeof(u16)));
+            r.read(quantized.data(), i32(quantized.size() * sizeof(u16)));
+            continue;
+          }
+
+          session.clips[index] = p;
+          session.padPoints[index] = pad;
+          auto row = session.clipParameters.data() + size_t(index) * numParameters;
+          std::copy(base.begin(), base.end(), row);
+
+          for (u32 j = 0; j < indices.size(); ++j) {
+            if (indices[j] < numParameters) {
+              row[indices[j]] = values[j];
+            }
+          }
+
+          quantizedIndices.resize(u32(std::max(r.readInt(), 0)));
+          quantized.resize(quantizedIndices.size());
+          r.read(quantizedIndices.data(), i32(quantizedIndices.size() * sizeof(u16)));
+          r.read(quantized.data(), i32(quantized.size() * sizeof(u16)));
+
+          for (u32 j = 0; j < quantizedIndices.size(); ++j) {
+            if (quantizedIndices[j] < numParameters) {
+              row[quantizedIndices[j]] = Clip::dequantize(quantized[j]);
+            }
+          }
+        }
+      }
+
+      i32 numPathChunks = r.readInt();
+
+      for (i32 i = 0; i < numPathChunks && !r.isExhausted(); ++i) {
+        u32 c = u32(r.readInt());
+        u32 count = u32(r.readInt());
+
+        for (u32 k = 0; k < count; ++k) {
+          u32 index = c * PersistentVector<Path>::chunkSize + k;
+          Session::Point p;
+          r.read(&p, sizeof(Session::Point));
+
+          if (index < numPaths) {
+            session.paths[index] = p;
+          }
+        }
+      }
+
+      if (r.readBool()) {
+        u32 n = u32(r.readInt());
+
+        for (u32 i = 0; i < n; ++i) {
+          bool a = r.readBool();
+
+          if (i < session.parameterActive.size()) {
+            session.parameterActive[i] = a;
+          }
+        }
+      }
+
+      session.quantizeClips = r.readBool();
+
+      if (r.readBool()) {
+        readSettings(r, session);
+      }
+    }
+  }
+
+  return haveSnapshot && session.isValid();
+}
+
+} // namespace atmt
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_events/juce_events.h>
+#include "document.hpp"
+#include "session.hpp"
+#include "types.hpp"
+#include <optional>
+
+namespace atmt {
+
+// NOTE(luca): crash recovery. Every committed Document is handed to a background thread which appends
+// the chunks that changed since the last write to a per-instance journal about once a second. The journal
+// starts with a full Session snapshot and is compacted into a fresh one every few seconds when something
+// changed. A clean shutdown deletes the files, anything left over belongs to an instance that crashed.
+struct Journal : juce::Thread, juce::Timer {
+  // NOTE(luca): the cheap parts of a Session that don't live in the Document, written with every delta
+  struct Settings {
+    f32 zoom = 100;
+    bool editMode = false;
+    bool discreteMode = false;
+    bool padMode = false;
+    f32 padX = 0.5f;
+    f32 padY = 0.5f;
+    std::vector<u8> parameterQuantized;
+    std::vector<u8> parameterCurves;
+
+    bool operator==(const Settings&) const = default;
+  };
+
+  // NOTE(luca): the parts of a Session that don't live in the Document, captured on the message thread.
+  // Asking the hosted plug-in for its state is the expensive part, it only happens every snapshotIntervalMs.
+  struct Meta {
+    juce::String pluginID;
+    juce::MemoryBlock pluginData;
+    juce::StringArray parameterNames;
+    Settings settings;
+  };
+
+  Journal();
+  ~Journal() override;
+
+  void start(const Document&);
+  void stop();
+  void push(const Document&);
+
+  void run() override;
+  void timerCallback() override;
+
+  void writeSnapshot(const Document&);
+  void writeDelta(const Document&, const std::optional<Settings>&);
+
+  static void toSession(const Document&, const Meta&, Session&);
+  static std::vector<juce::File> findOrphans();
+  static bool recover(const juce::File&, Session&);
+
+  static constexpr i32 magic = 0x4a4d5441; // NOTE(luca): "ATMJ"
+  static constexpr i32 version = 4;
+  static constexpr i32 snapshotRecord = 0;
+  static constexpr i32 deltaRecord = 1;
+  static constexpr i32 writeIntervalMs = 1000;
+  static constexpr i32 snapshotIntervalMs = 10000;
+
+  std::function<Meta()> captureMeta;
+  std::function<Settings()> captureSettings;
+  std::function<u64()> captureGeneration;
+
+  // NOTE(luca): only touched on the message thread, settings and meta are captured again once the
+  // generation moves
+  u64 settingsGeneration = 0;
+  u64 metaGeneration = 0;
+  u32 ticksSinceMeta = 0;
+
+  juce::String id = juce::Uuid().toString();
+  juce::File file;
+  std::unique_ptr<juce::InterProcessLock> ownerLock;
+
+  juce::CriticalSection lock;
+  bool active = false;
+  bool discard = false;
+  std::optional<Document> pending;
+  std::optional<Meta> pendingMeta;
+  std::optional<Settings> pendingSettings;
+
+  // NOTE(luca): only touched on the journal thread
+  Document written;
+  Meta writtenMeta;
+  u32 deltasSinceSnapshot = 0;
+  std::unique_ptr<juce::FileOutputStream> out;
+};
+
+} // namespace atmt
@@ -1,4 +1,10 @@
 #include "utils.cpp"
+#include "session.cpp"
+#include "document.cpp"
+#include "journal.cpp"
+#include "recorder.cpp"
+#include "plugin_scanner.cpp"
+#include "plugin_library.cpp"
 #include "state_manager.cpp"
 #include "plugin.cpp"
 #include "editor.cpp"
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include "plugin_index.hpp"
+#include "types.hpp"
+
+namespace atmt {
+
+// NOTE(luca): same matching rules as PluginIndex, results are parameter indices
+struct ParameterIndex {
+  void rebuild(const juce::StringArray& names) {
+    searchNames.clearQuick();
+    byName.resize(u32(names.size()));
+
+    for (u32 i = 0; i < u32(names.size()); ++i) {
+      searchNames.add(names[i32(i)].toLowerCase());
+      byName[i] = i;
+    }
+
+    std::sort(byName.begin(), byName.end(), [this] (u32 a, u32 b) { return searchNames[i32(a)] < searchNames[i32(b)]; });
+  }
+
+  // NOTE(luca): an empty query lists every parameter in plug-in order
+  void search(const juce::String& query, std::vector<u32>& result) const {
+    result.clear();
+
+    auto q = query.trim().toLowerCase();
+
+    if (q.isEmpty()) {
+      result.resize(byName.size());
+
+      for (u32 i = 0; i < result.size(); ++i) {
+        result[i] = i;
+      }
+
+      return;
+    }
+
+    auto it = std::lower_bound(byName.begin(), byName.end(), q, [this] (u32 i, const juce::String& s) { return searchNames[i32(i)] < s; });
+
+    for (; it != byName.end() && searchNames[i32(*it)].startsWith(q); ++it) {
+      result.push_back(*it);
+    }
+
+    for (u32 i : byName) {
+      const auto& name = searchNames[i32(i)];
+
+      if (!name.startsWith(q) && name.contains(q)) {
+        result.push_back(i);
+      }
+    }
+
+    for (u32 i : byName) {
+      const auto& name = searchNames[i32(i)];
+
+      if (!name.contains(q) && PluginIndex::isSubsequence(q, name)) {
+        result.push_back(i);
+      }
+    }
+  }
+
+  juce::StringArray searchNames;
+  std::vector<u32> byName;
+};
+
+} // namespace atmt
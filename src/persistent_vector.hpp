@@ -0,0 +1,64 @@
+#pragma once
+
+#include "types.hpp"
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <assert.h>
+
+namespace atmt {
+
+// NOTE(luca): immutable vector split into fixed size chunks. A new version only rebuilds the chunks
+// that were flagged dirty and shares every other chunk with the version it was made from, so keeping
+// many versions around costs memory proportional to what changed between them.
+template <typename T>
+struct PersistentVector {
+  static constexpr u32 chunkSize = 32;
+  using Chunk = std::vector<T>;
+
+  static u32 getNumChunks(u32 n) {
+    return (n + chunkSize - 1) / chunkSize;
+  }
+
+  static PersistentVector update(const PersistentVector& prev, const std::vector<T>& live, const std::vector<bool>& dirty) {
+    PersistentVector next;
+    next.size = u32(live.size());
+    next.chunks.resize(getNumChunks(next.size));
+
+    for (u32 c = 0; c < next.chunks.size(); ++c) {
+      u32 begin = c * chunkSize;
+      u32 end = std::min(begin + chunkSize, next.size);
+
+      bool reuse = c < prev.chunks.size()
+                && !(c < dirty.size() && dirty[c])
+                && prev.chunks[c]->size() == end - begin;
+
+      if (reuse) {
+        next.chunks[c] = prev.chunks[c];
+      } else {
+        next.chunks[c] = std::make_shared<const Chunk>(live.begin() + begin, live.begin() + end);
+      }
+    }
+
+    return next;
+  }
+
+  // NOTE(luca): live has to hold the contents of current, only the chunks this version doesn't share
+  // with it are copied
+  void apply(const PersistentVector& current, std::vector<T>& live) const {
+    assert(live.size() == current.size);
+
+    live.resize(size);
+
+    for (u32 c = 0; c < chunks.size(); ++c) {
+      if (c >= current.chunks.size() || chunks[c] != current.chunks[c]) {
+        std::copy(chunks[c]->begin(), chunks[c]->end(), live.begin() + c * chunkSize);
+      }
+    }
+  }
+
+  std::vector<std::shared_ptr<const Chunk>> chunks;
+  u32 size = 0;
+};
+
+} // namespace atmt
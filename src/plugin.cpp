@@ -10,21 +10,16 @@ namespace atmt {
 
 Plugin::Plugin()
   : AudioProcessor(DEFAULT_BUSES) {
-  FilePath::init();
-  loadKnownPluginList(knownPluginList);
-  apfm.addDefaultFormats();
   manager.init();
 }
 
-Plugin::~Plugin() {
-  saveKnownPluginList(knownPluginList);
-}
+Plugin::~Plugin() {}
 
 void Plugin::prepareToPlay(double sampleRate, int blockSize) {
   JUCE_ASSERT_MESSAGE_THREAD
   jassert(sampleRate > 0 && blockSize > 0);
 
-  if (manager.instance) {
+  if (engine.instance) {
     engine.prepare(f32(sampleRate), blockSize);
   }
 }
@@ -35,7 +30,9 @@ void Plugin::processBlock(juce::AudioBuffer<f32>& buffer, juce::MidiBuffer& midi
   //scoped_timer t("Plugin::processBlock()");
   juce::ScopedNoDenormals noDeNormals;
 
-  if (manager.instance) {
+  // NOTE(luca): the hosted instance is published by StateManager::installPlugin once it's ready,
+  // until then we pass the input through
+  if (engine.instance) {
     for (auto i = getTotalNumInputChannels(); i < getTotalNumOutputChannels(); i++)
       buffer.clear(i, 0, buffer.getNumSamples());
 
@@ -51,11 +48,18 @@ void Plugin::processBlock(juce::AudioBuffer<f32>& buffer, juce::MidiBuffer& midi
           auto ppq = position->getPpqPosition();
           auto sec = position->getTimeInSeconds();
 
+          f32 newPosition = manager.playheadPosition.load();
+
           if (ppq.hasValue()) {
-            manager.playheadPosition.store(f32(*ppq));
+            newPosition = f32(*ppq);
           } else if (sec.hasValue()) {
             // TODO(luca): we need a way of converting seconds to ppq
-            manager.playheadPosition.store(f32(*sec));
+            newPosition = f32(*sec);
+          }
+
+          if (neqf32(manager.playheadPosition.load(), newPosition)) {
+            manager.playheadPosition.store(newPosition);
+            manager.transportChanged.store(true);
           }
         }
 
@@ -66,8 +70,14 @@ void Plugin::processBlock(juce::AudioBuffer<f32>& buffer, juce::MidiBuffer& midi
 
         auto timeSignature = position->getTimeSignature();
         if (timeSignature.hasValue()) {
-          manager.numerator = u32(timeSignature->numerator);
-          manager.denominator = u32(timeSignature->denominator);
+          u32 numerator = u32(timeSignature->numerator);
+          u32 denominator = u32(timeSignature->denominator);
+
+          if (numerator != manager.numerator.load() || denominator != manager.denominator.load()) {
+            manager.numerator = numerator;
+            manager.denominator = denominator;
+            manager.transportChanged.store(true);
+          }
         }
       }
     }
@@ -106,15 +116,25 @@ juce::AudioProcessorEditor* Plugin::createEditor() {
 }
 
 void Plugin::getStateInformation(juce::MemoryBlock& mb) {
-  std::unique_ptr<juce::XmlElement> xml(manager.getState().createXml());
-  copyXmlToBinary(*xml, mb);
+  manager.getStateInformation(mb);
 }
 
 void Plugin::setStateInformation(const void* data, int size) {
+  auto session = std::make_unique<Session>();
+
+  if (session->read(data, size_t(size))) {
+    manager.replace(std::move(session));
+    return;
+  }
+
+  // NOTE(luca): sessions saved before the binary format are xml
   std::unique_ptr<juce::XmlElement> xml(getXmlFromBinary(data, size));
   if (xml.get() != nullptr) {
-    auto tree = juce::ValueTree::fromXml(*xml);
-    manager.replace(tree);
+    session = std::make_unique<Session>();
+
+    if (session->importLegacy(juce::ValueTree::fromXml(*xml))) {
+      manager.replace(std::move(session));
+    }
   }
 }
 
@@ -3,6 +3,7 @@
 #include "utils.hpp"
 #include "state_manager.hpp"
 #include "engine.hpp"
+#include "plugin_library.hpp"
 #include <juce_audio_processors/juce_audio_processors.h>
 #include "types.hpp"
 #include "logger.hpp"
@@ -37,13 +38,11 @@ struct Plugin : juce::AudioProcessor {
   void getStateInformation(juce::MemoryBlock& destData) override;
   void setStateInformation(const void* data, int sizeInBytes) override;
 
+  juce::SharedResourcePointer<PluginLibrary> library;
   StateManager manager { *this };
   Engine engine { manager }; 
 
   Logger logger;
-
-  juce::AudioPluginFormatManager apfm;
-  juce::KnownPluginList knownPluginList;
 };
 
 } // namespace atmt
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include "types.hpp"
+#include <unordered_map>
+
+namespace atmt {
+
+struct PluginIndex {
+  struct Entry {
+    juce::PluginDescription description;
+    juce::String format;
+    juce::String searchName;
+  };
+
+  void rebuild(const juce::KnownPluginList& kpl) {
+    entries.clear();
+    manufacturers.clear();
+    buckets.clear();
+    byName.clear();
+
+    for (const auto& t : kpl.getTypes()) {
+      entries.push_back({ t, t.pluginFormatName == "AudioUnit" ? "AU" : t.pluginFormatName, t.name.toLowerCase() });
+      manufacturers.add(t.manufacturerName);
+    }
+
+    manufacturers.removeDuplicates(false);
+    manufacturers.sortNatural();
+
+    std::unordered_map<juce::String, u32> manufacturerIndex;
+    buckets.resize(u32(manufacturers.size()));
+
+    for (u32 i = 0; i < u32(manufacturers.size()); ++i) {
+      manufacturerIndex[manufacturers[i32(i)]] = i;
+    }
+
+    byName.resize(entries.size());
+
+    for (u32 i = 0; i < entries.size(); ++i) {
+      byName[i] = i;
+    }
+
+    std::sort(byName.begin(), byName.end(), [this] (u32 a, u32 b) { return entries[a].searchName < entries[b].searchName; });
+
+    for (u32 i : byName) {
+      buckets[manufacturerIndex[entries[i].description.manufacturerName]].push_back(i);
+    }
+  }
+
+  i32 findManufacturer(const juce::String& name) const {
+    return manufacturers.indexOf(name);
+  }
+
+  // NOTE(luca): prefix matches come first and are found by binary search over the sorted names,
+  // then substring matches, then names that contain the query as a subsequence
+  void search(const juce::String& query, std::vector<u32>& result) const {
+    result.clear();
+
+    auto q = query.trim().toLowerCase();
+
+    if (q.isEmpty()) {
+      return;
+    }
+
+    auto it = std::lower_bound(byName.begin(), byName.end(), q, [this] (u32 i, const juce::String& s) { return entries[i].searchName < s; });
+
+    for (; it != byName.end() && entries[*it].searchName.startsWith(q); ++it) {
+      result.push_back(*it);
+    }
+
+    for (u32 i : byName) {
+      const auto& name = entries[i].searchName;
+
+      if (!name.startsWith(q) && name.contains(q)) {
+        result.push_back(i);
+      }
+    }
+
+    for (u32 i : byName) {
+      const auto& name = entries[i].searchName;
+
+      if (!name.contains(q) && isSubsequence(q, name)) {
+        result.push_back(i);
+      }
+    }
+  }
+
+  static bool isSubsequence(const juce::String& q, const juce::String& s) {
+    auto a = q.getCharPointer();
+    auto b = s.getCharPointer();
+
+    while (!a.isEmpty() && !b.isEmpty()) {
+      if (*a == *b) {
+        ++a;
+      }
+
+      ++b;
+    }
+
+    return a.isEmpty();
+  }
+
+  std::vector<Entry> entries;
+  juce::StringArray manufacturers;
+  std::vector<std::vector<u32>> buckets;
+  std::vector<u32> byName;
+};
+
+} // namespace atmt
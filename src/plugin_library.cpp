@@ -0,0 +1,182 @@
+#include "plugin_library.hpp"
+#include "utils.hpp"
+#include "logger.hpp"
+
+namespace atmt {
+
+PluginLibrary::~PluginLibrary() {
+  scanner.reset();
+  save();
+}
+
+juce::AudioPluginFormatManager& PluginLibrary::getFormatManager() {
+  load();
+  return apfm;
+}
+
+juce::KnownPluginList& PluginLibrary::getKnownPluginList() {
+  load();
+  return knownPluginList;
+}
+
+PluginScanner& PluginLibrary::getScanner() {
+  load();
+  return *scanner;
+}
+
+void PluginLibrary::load() {
+  const juce::ScopedLock sl(lock);
+
+  if (loaded) {
+    return;
+  }
+
+  loaded = true;
+
+  FilePath::init();
+  apfm.addDefaultFormats();
+
+  if (readCache()) {
+    writeCache(lastSaved);
+  } else {
+    // NOTE(luca): older versions stored the list as xml, import it once and let save() write the cache
+    Logger::info("Importing " + FilePath::knownPluginList.getFullPathName());
+    loadKnownPluginList(knownPluginList);
+  }
+
+  scanner = std::make_unique<PluginScanner>(apfm, knownPluginList);
+  scanner->onScanFinished = [this] {
+    save();
+    knownPluginList.sendChangeMessage();
+  };
+}
+
+void PluginLibrary::save() {
+  const juce::ScopedLock sl(lock);
+
+  if (!loaded) {
+    return;
+  }
+
+  juce::MemoryBlock mb;
+  writeCache(mb);
+
+  if (mb == lastSaved) {
+    return;
+  }
+
+  juce::TemporaryFile temp(FilePath::pluginListCache);
+
+  if (temp.getFile().replaceWithData(mb.getData(), mb.getSize()) && temp.overwriteTargetFileWithTemporary()) {
+    lastSaved = std::move(mb);
+  } else {
+    Logger::error("Failed to write " + FilePath::pluginListCache.getFullPathName());
+  }
+}
+
+bool PluginLibrary::readCache() {
+  juce::MemoryMappedFile mapped(FilePath::pluginListCache, juce::MemoryMappedFile::readOnly);
+
+  if (mapped.getData() == nullptr) {
+    return false;
+  }
+
+  juce::MemoryInputStream in(mapped.getData(), mapped.getSize(), false);
+
+  if (in.readInt() != magic || in.readInt() != version) {
+    return false;
+  }
+
+  // NOTE(luca): a truncated cache is rejected as a whole so that the XML list gets imported instead,
+  // nothing is added to the list until everything has been read
+  i32 numTypes = in.readInt();
+  std::vector<juce::PluginDescription> types;
+
+  for (i32 i = 0; i < numTypes; ++i) {
+    if (in.isExhausted()) {
+      return false;
+    }
+
+    juce::PluginDescription d;
+    d.name               = in.readString();
+    d.descriptiveName    = in.readString();
+    d.pluginFormatName   = in.readString();
+    d.category           = in.readString();
+    d.manufacturerName   = in.readString();
+    d.version            = in.readString();
+    d.fileOrIdentifier   = in.readString();
+    d.lastFileModTime    = juce::Time(in.readInt64());
+    d.lastInfoUpdateTime = juce::Time(in.readInt64());
+    d.deprecatedUid      = in.readInt();
+    d.uniqueId           = in.readInt();
+    d.isInstrument       = in.readBool();
+    d.numInputChannels   = in.readInt();
+    d.numOutputChannels  = in.readInt();
+    d.hasSharedContainer = in.readBool();
+    d.hasARAExtension    = in.readBool();
+    types.push_back(std::move(d));
+  }
+
+  if (in.getNumBytesRemaining() < i64(sizeof(i32))) {
+    return false;
+  }
+
+  i32 numBlacklisted = in.readInt();
+  juce::StringArray blacklist;
+
+  for (i32 i = 0; i < numBlacklisted; ++i) {
+    if (in.isExhausted()) {
+      return false;
+    }
+
+    blacklist.add(in.readString());
+  }
+
+  for (const auto& d : types) {
+    knownPluginList.addType(d);
+  }
+
+  for (const auto& b : blacklist) {
+    knownPluginList.addToBlacklist(b);
+  }
+
+  return true;
+}
+
+void PluginLibrary::writeCache(juce::MemoryBlock& mb) {
+  juce::MemoryOutputStream out(mb, false);
+
+  auto types = knownPluginList.getTypes();
+  auto blacklist = knownPluginList.getBlacklistedFiles();
+
+  out.writeInt(magic);
+  out.writeInt(version);
+  out.writeInt(types.size());
+
+  for (const auto& d : types) {
+    out.writeString(d.name);
+    out.writeString(d.descriptiveName);
+    out.writeString(d.pluginFormatName);
+    out.writeString(d.category);
+    out.writeString(d.manufacturerName);
+    out.writeString(d.version);
+    out.writeString(d.fileOrIdentifier);
+    out.writeInt64(d.lastFileModTime.toMilliseconds());
+    out.writeInt64(d.lastInfoUpdateTime.toMilliseconds());
+    out.writeInt(d.deprecatedUid);
+    out.writeInt(d.uniqueId);
+    out.writeBool(d.isInstrument);
+    out.writeInt(d.numInputChannels);
+    out.writeInt(d.numOutputChannels);
+    out.writeBool(d.hasSharedContainer);
+    out.writeBool(d.hasARAExtension);
+  }
+
+  out.writeInt(blacklist.size());
+
+  for (const auto& f : blacklist) {
+    out.writeString(f);
+  }
+}
+
+} // namespace atmt
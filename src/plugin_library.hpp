@@ -0,0 +1,37 @@
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include "plugin_scanner.hpp"
+#include "types.hpp"
+
+namespace atmt {
+
+// NOTE(luca): one instance per process shared by every Automate instance through a
+// juce::SharedResourcePointer. Nothing touches the disk until the list is first used.
+struct PluginLibrary {
+  PluginLibrary() = default;
+  ~PluginLibrary();
+
+  juce::AudioPluginFormatManager& getFormatManager();
+  juce::KnownPluginList& getKnownPluginList();
+  PluginScanner& getScanner();
+
+  void load();
+  void save();
+
+  bool readCache();
+  void writeCache(juce::MemoryBlock&);
+
+  static constexpr i32 magic = 0x4c505441; // NOTE(luca): "ATPL"
+  static constexpr i32 version = 1;
+
+  juce::CriticalSection lock;
+  bool loaded = false;
+  juce::MemoryBlock lastSaved;
+
+  juce::AudioPluginFormatManager apfm;
+  juce::KnownPluginList knownPluginList;
+  std::unique_ptr<PluginScanner> scanner;
+};
+
+} // namespace atmt
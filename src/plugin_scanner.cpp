@@ -0,0 +1,308 @@
+#include "plugin_scanner.hpp"
+#include "utils.hpp"
+#include "logger.hpp"
+
+namespace atmt {
+
+PluginScanner::PluginScanner(juce::AudioPluginFormatManager& fm, juce::KnownPluginList& kpl)
+  : juce::Thread("Automate Plugin Scanner"), formatManager(fm), knownPluginList(kpl) {
+  startThread();
+}
+
+PluginScanner::~PluginScanner() {
+  cancelPendingUpdate();
+  signalThreadShouldExit();
+  notify();
+  stopThread(i32(timeoutMs));
+}
+
+void PluginScanner::scan(const juce::StringArray& files) {
+  JUCE_ASSERT_MESSAGE_THREAD
+
+  if (!getScannerExecutable().existsAsFile()) {
+    Logger::warn("Scanner executable not found, scanning on the message thread");
+
+    juce::OwnedArray<juce::PluginDescription> types;
+    knownPluginList.scanAndAddDragAndDroppedFiles(formatManager, files, types);
+
+    if (onScanFinished) {
+      onScanFinished();
+    }
+
+    return;
+  }
+
+  {
+    const juce::ScopedLock sl(lock);
+    pendingFiles.addArray(files);
+  }
+
+  scanning = true;
+  notify();
+}
+
+void PluginScanner::scanDefaultLocations() {
+  JUCE_ASSERT_MESSAGE_THREAD
+
+  if (!getScannerExecutable().existsAsFile()) {
+    Logger::warn("Scanner executable not found, skipping scan of default locations");
+    return;
+  }
+
+  {
+    const juce::ScopedLock sl(lock);
+    pendingDefaultLocations = true;
+  }
+
+  scanning = true;
+  notify();
+}
+
+bool PluginScanner::isScanning() {
+  return scanning;
+}
+
+void PluginScanner::run() {
+  loadCache();
+
+  while (!threadShouldExit()) {
+    juce::StringArray files;
+    bool defaultLocations = false;
+
+    {
+      const juce::ScopedLock sl(lock);
+      files.swapWith(pendingFiles);
+      defaultLocations = std::exchange(pendingDefaultLocations, false);
+    }
+
+    if (files.isEmpty() && !defaultLocations) {
+      wait(-1);
+      continue;
+    }
+
+    std::vector<Job> jobs;
+
+    for (auto* format : formatManager.getFormats()) {
+      if (defaultLocations) {
+        auto found = format->searchPathsForPlugins(format->getDefaultLocationsToSearch(), true, false);
+
+        for (const auto& f : found) {
+          jobs.push_back({ format->getName(), f });
+        }
+      }
+
+      for (const auto& f : files) {
+        if (format->fileMightContainThisPluginType(f)) {
+          jobs.push_back({ format->getName(), f });
+        }
+      }
+    }
+
+    std::vector<Result> scanned;
+    std::vector<Job> toScan;
+
+    for (const auto& job : jobs) {
+      auto it = cache.find(job.fileOrIdentifier);
+      i64 time = getModificationTime(job.fileOrIdentifier);
+
+      if (it != cache.end() && time != 0 && it->second.modificationTime == time) {
+        scanned.push_back(it->second);
+      } else {
+        toScan.push_back(job);
+      }
+    }
+
+    Logger::info("Scanning " + juce::String(toScan.size()) + " plug-in files, " + juce::String(scanned.size()) + " cached");
+
+    {
+      std::vector<std::optional<Result>> childResults(toScan.size());
+
+      {
+        juce::ThreadPool pool(juce::SystemStats::getNumCpus());
+
+        for (u32 i = 0; i < toScan.size(); ++i) {
+          pool.addJob([this, &toScan, &childResults, i] { childResults[i] = scanInChildProcess(toScan[i]); });
+        }
+
+        while (pool.getNumJobs() > 0 && !threadShouldExit()) {
+          wait(50);
+        }
+      }
+
+      for (auto& r : childResults) {
+        if (r) {
+          cache[r->fileOrIdentifier] = *r;
+          scanned.push_back(std::move(*r));
+        }
+      }
+    }
+
+    saveCache();
+
+    {
+      const juce::ScopedLock sl(lock);
+
+      for (const auto& r : scanned) {
+        if (r.failed) {
+          failedFiles.add(r.fileOrIdentifier);
+        } else {
+          foundTypes.addArray(r.types);
+        }
+      }
+
+      scanning = !pendingFiles.isEmpty() || pendingDefaultLocations;
+    }
+
+    triggerAsyncUpdate();
+  }
+}
+
+void PluginScanner::handleAsyncUpdate() {
+  JUCE_ASSERT_MESSAGE_THREAD
+
+  juce::Array<juce::PluginDescription> types;
+  juce::StringArray failed;
+
+  {
+    const juce::ScopedLock sl(lock);
+    types.swapWith(foundTypes);
+    failed.swapWith(failedFiles);
+  }
+
+  for (const auto& t : types) {
+    knownPluginList.removeFromBlacklist(t.fileOrIdentifier);
+    knownPluginList.addType(t);
+  }
+
+  for (const auto& f : failed) {
+    Logger::warn("Plug-in failed to scan: " + f);
+    knownPluginList.addToBlacklist(f);
+  }
+
+  if (onScanFinished) {
+    onScanFinished();
+  }
+}
+
+std::optional<PluginScanner::Result> PluginScanner::scanInChildProcess(const Job& job) {
+  Result result;
+  result.fileOrIdentifier = job.fileOrIdentifier;
+  result.modificationTime = getModificationTime(job.fileOrIdentifier);
+
+  juce::TemporaryFile output(".xml");
+  juce::ChildProcess child;
+
+  juce::StringArray args {
+    getScannerExecutable().getFullPathName(),
+    job.format,
+    job.fileOrIdentifier,
+    output.getFile().getFullPathName()
+  };
+
+  if (!child.start(args, 0)) {
+    result.failed = true;
+    return result;
+  }
+
+  u32 start = juce::Time::getMillisecondCounter();
+
+  while (!child.waitForProcessToFinish(50)) {
+    if (threadShouldExit()) {
+      child.kill();
+      return std::nullopt;
+    }
+
+    if (juce::Time::getMillisecondCounter() - start > timeoutMs) {
+      child.kill();
+      result.failed = true;
+      return result;
+    }
+  }
+
+  if (child.getExitCode() != 0) {
+    result.failed = true;
+    return result;
+  }
+
+  if (auto xml = juce::XmlDocument::parse(output.getFile())) {
+    for (auto* e : xml->getChildIterator()) {
+      juce::PluginDescription description;
+
+      if (description.loadFromXml(*e)) {
+        result.types.add(description);
+      }
+    }
+  } else {
+    result.failed = true;
+  }
+
+  return result;
+}
+
+void PluginScanner::loadCache() {
+  cache.clear();
+
+  auto xml = juce::XmlDocument::parse(FilePath::scanCache);
+
+  if (!xml) {
+    return;
+  }
+
+  for (auto* e : xml->getChildWithTagNameIterator("ENTRY")) {
+    Result r;
+    r.fileOrIdentifier = e->getStringAttribute("file");
+    r.modificationTime = e->getStringAttribute("time").getLargeIntValue();
+    r.failed = e->getBoolAttribute("failed");
+
+    for (auto* t : e->getChildIterator()) {
+      juce::PluginDescription description;
+
+      if (description.loadFromXml(*t)) {
+        r.types.add(description);
+      }
+    }
+
+    cache[r.fileOrIdentifier] = r;
+  }
+}
+
+void PluginScanner::saveCache() {
+  juce::XmlElement xml("SCANCACHE");
+
+  for (const auto& [file, r] : cache) {
+    auto* e = xml.createNewChildElement("ENTRY");
+    e->setAttribute("file", r.fileOrIdentifier);
+    e->setAttribute("time", juce::String(r.modificationTime));
+    e->setAttribute("failed", i32(r.failed));
+
+    for (const auto& t : r.types) {
+      e->addChildElement(t.createXml().release());
+    }
+  }
+
+  xml.writeTo(FilePath::scanCache);
+}
+
+juce::File PluginScanner::getScannerExecutable() {
+  auto dir = juce::File::getSpecialLocation(juce::File::currentExecutableFile).getParentDirectory();
+
+#if JUCE_WINDOWS
+  return dir.getChildFile("Automate-Scanner.exe");
+#else
+  return dir.getChildFile("Automate-Scanner");
+#endif
+}
+
+i64 PluginScanner::getModificationTime(const juce::String& fileOrIdentifier) {
+  if (juce::File::isAbsolutePath(fileOrIdentifier)) {
+    juce::File f(fileOrIdentifier);
+
+    if (f.exists()) {
+      return f.getLastModificationTime().toMilliseconds();
+    }
+  }
+
+  return 0;
+}
+
+} // namespace atmt
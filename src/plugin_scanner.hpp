@@ -0,0 +1,60 @@
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include "types.hpp"
+#include <optional>
+
+namespace atmt {
+
+// NOTE(luca): scans plug-ins in child processes (see scanner_main.cpp) so that a plug-in crashing or
+// hanging while being instantiated can't take the host down with it
+struct PluginScanner : juce::Thread, juce::AsyncUpdater {
+  struct Job {
+    juce::String format;
+    juce::String fileOrIdentifier;
+  };
+
+  struct Result {
+    juce::String fileOrIdentifier;
+    i64 modificationTime = 0;
+    bool failed = false;
+    juce::Array<juce::PluginDescription> types;
+  };
+
+  PluginScanner(juce::AudioPluginFormatManager&, juce::KnownPluginList&);
+  ~PluginScanner() override;
+
+  void scan(const juce::StringArray&);
+  void scanDefaultLocations();
+  bool isScanning();
+
+  void run() override;
+  void handleAsyncUpdate() override;
+
+  std::optional<Result> scanInChildProcess(const Job&);
+  void loadCache();
+  void saveCache();
+
+  static juce::File getScannerExecutable();
+  static i64 getModificationTime(const juce::String&);
+
+  static constexpr u32 timeoutMs = 60000;
+
+  juce::AudioPluginFormatManager& formatManager;
+  juce::KnownPluginList& knownPluginList;
+
+  std::function<void()> onScanFinished;
+
+  std::atomic<bool> scanning = false;
+
+  juce::CriticalSection lock;
+  juce::StringArray pendingFiles;
+  bool pendingDefaultLocations = false;
+  juce::Array<juce::PluginDescription> foundTypes;
+  juce::StringArray failedFiles;
+
+  // NOTE(luca): only touched on the scanner thread
+  std::map<juce::String, Result> cache;
+};
+
+} // namespace atmt
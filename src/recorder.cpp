@@ -0,0 +1,139 @@
+#include "recorder.hpp"
+#include "utils.hpp"
+
+namespace atmt {
+
+Recorder::Recorder() {
+  buffer.resize(capacity);
+  window.reserve(maxWindow + 1);
+}
+
+void Recorder::push(f32 x, f32 y) {
+  // NOTE(luca): a full fifo drops the sample, the take just gets coarser
+  if (auto scope = fifo.write(1); scope.blockSize1 > 0) {
+    buffer[size_t(scope.startIndex1)] = { x, std::clamp(y, 0.f, 1.f) };
+  }
+}
+
+void Recorder::drain() {
+  JUCE_ASSERT_MESSAGE_THREAD
+
+  auto scope = fifo.read(fifo.getNumReady());
+
+  for (i32 i = 0; i < scope.blockSize1; ++i) {
+    add(buffer[size_t(scope.startIndex1 + i)]);
+  }
+
+  for (i32 i = 0; i < scope.blockSize2; ++i) {
+    add(buffer[size_t(scope.startIndex2 + i)]);
+  }
+}
+
+std::vector<Path> Recorder::finish() {
+  JUCE_ASSERT_MESSAGE_THREAD
+
+  drain();
+
+  if (window.size() > 1) {
+    keep(u32(window.size() - 1));
+  }
+
+  window.clear();
+  return std::exchange(take, {});
+}
+
+void Recorder::add(Sample s) {
+  if (window.empty()) {
+    window.push_back(s);
+    take.push_back({ s.x, s.y, 0.5f });
+    return;
+  }
+
+  // NOTE(luca): a stopped or looping transport doesn't move forward, those samples can't go on the lane
+  if (!(s.x > window.back().x)) {
+    return;
+  }
+
+  window.push_back(s);
+
+  u32 last = u32(window.size() - 1);
+  const auto& a = window.front();
+  f32 slope = (s.y - a.y) / (s.x - a.x);
+
+  bool fits = last <= maxWindow;
+
+  for (u32 i = 1; fits && i < last; ++i) {
+    f32 y = a.y + (window[i].x - a.x) * slope;
+    fits = std::abs(window[i].y - y) <= tolerance;
+  }
+
+  if (!fits) {
+    keep(last - 1);
+  }
+}
+
+// NOTE(luca): window[index] becomes a point of the take, the samples before it are fitted and dropped
+void Recorder::keep(u32 index) {
+  assert(index > 0 && index < window.size());
+
+  Path p { window[index].x, window[index].y, 0.5f };
+  p.c = fitCurve(take.back(), p, window.data() + 1, index - 1);
+  take.push_back(p);
+
+  window.erase(window.begin(), window.begin() + index);
+}
+
+// NOTE(luca): same quadratic as StateManager::buildAutomationPath, x is monotonic in t so bisection finds it
+f32 Recorder::evaluate(const Path& p1, const Path& p2, f32 x) {
+  f32 cx = p1.x + (p2.x - p1.x) * (p1.y < p2.y ? p2.c : 1.f - p2.c);
+  f32 cy = std::min(p1.y, p2.y) + std::abs(p2.y - p1.y) * (1.f - p2.c);
+
+  f32 lo = 0;
+  f32 hi = 1;
+
+  for (u32 i = 0; i < 16; ++i) {
+    f32 t = (lo + hi) * 0.5f;
+    f32 u = 1 - t;
+    f32 tx = u * u * p1.x + 2 * u * t * cx + t * t * p2.x;
+
+    if (tx < x) {
+      lo = t;
+    } else {
+      hi = t;
+    }
+  }
+
+  f32 t = (lo + hi) * 0.5f;
+  f32 u = 1 - t;
+  return u * u * p1.y + 2 * u * t * cy + t * t * p2.y;
+}
+
+f32 Recorder::fitCurve(const Path& p1, const Path& p2, const Sample* samples, u32 numSamples) {
+  if (numSamples == 0 || !neqf32(p1.y, p2.y)) {
+    return 0.5f;
+  }
+
+  f32 best = 0.5f;
+  f32 bestError = std::numeric_limits<f32>::max();
+
+  for (u32 step = 0; step <= curveSteps; ++step) {
+    Path candidate = p2;
+    candidate.c = f32(step) / f32(curveSteps);
+
+    f32 error = 0;
+
+    for (u32 i = 0; i < numSamples; ++i) {
+      f32 d = evaluate(p1, candidate, samples[i].x) - samples[i].y;
+      error += d * d;
+    }
+
+    if (error < bestError) {
+      bestError = error;
+      best = candidate.c;
+    }
+  }
+
+  return best;
+}
+
+} // namespace atmt
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_events/juce_events.h>
+#include "document.hpp"
+#include "types.hpp"
+
+namespace atmt {
+
+// NOTE(luca): records the automation lane while a hosted parameter is being moved. The audio thread pushes
+// one sample per block into a fifo and the message thread simplifies the take as it drains it: a point is
+// only kept once the line from the last kept point can't stand in for the samples since, and every kept
+// point gets the curve that best fits the samples of its segment.
+struct Recorder {
+  struct Sample {
+    f32 x = 0;
+    f32 y = 0;
+  };
+
+  Recorder();
+
+  void push(f32, f32);
+  void drain();
+  std::vector<Path> finish();
+
+  void add(Sample);
+  void keep(u32);
+
+  static f32 evaluate(const Path&, const Path&, f32);
+  static f32 fitCurve(const Path&, const Path&, const Sample*, u32);
+
+  static constexpr i32 capacity = 16384;
+  static constexpr f32 tolerance = 0.01f;
+  static constexpr u32 maxWindow = 256;
+  static constexpr u32 curveSteps = 16;
+
+  juce::AbstractFifo fifo { capacity };
+  std::vector<Sample> buffer;
+
+  // NOTE(luca): only touched on the message thread, window[0] is the last kept point
+  std::vector<Sample> window;
+  std::vector<Path> take;
+};
+
+} // namespace atmt
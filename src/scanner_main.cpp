@@ -0,0 +1,38 @@
+#include <juce_audio_processors/juce_audio_processors.h>
+
+// NOTE(luca): child process used by PluginScanner, scans a single file and writes the found
+// descriptions to an xml file. A crash or hang here only costs the parent that file.
+//
+// Usage: Automate-Scanner <format name> <file or identifier> <output file>
+
+int main(int argc, char* argv[]) {
+  if (argc != 4) {
+    return 1;
+  }
+
+  juce::ScopedJuceInitialiser_GUI init;
+
+  juce::String formatName = juce::CharPointer_UTF8(argv[1]);
+  juce::String fileOrIdentifier = juce::CharPointer_UTF8(argv[2]);
+  juce::File output = juce::File(juce::CharPointer_UTF8(argv[3]));
+
+  juce::AudioPluginFormatManager apfm;
+  apfm.addDefaultFormats();
+
+  for (auto* format : apfm.getFormats()) {
+    if (format->getName() == formatName) {
+      juce::OwnedArray<juce::PluginDescription> types;
+      format->findAllTypesForFile(types, fileOrIdentifier);
+
+      juce::XmlElement xml("TYPES");
+
+      for (auto* t : types) {
+        xml.addChildElement(t->createXml().release());
+      }
+
+      return xml.writeTo(output) ? 0 : 1;
+    }
+  }
+
+  return 1;
+}
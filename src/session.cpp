@@ -0,0 +1,277 @@
+#include "session.hpp"
+
+namespace atmt {
+
+bool Session::isValid() const {
+  return pluginID.isNotEmpty();
+}
+
+const f32* Session::getClipParameters(u32 i) const {
+  assert(i < clips.size());
+  return clipParameters.data() + size_t(i) * numParameters;
+}
+
+void Session::write(juce::MemoryBlock& mb) const {
+  assert(clipParameters.size() == clips.size() * numParameters);
+  assert(parameterActive.size() == numParameters);
+  assert(padPoints.empty() || padPoints.size() == clips.size());
+
+  juce::MemoryBlock names;
+
+  {
+    juce::MemoryOutputStream out(names, false);
+
+    for (const auto& n : parameterNames) {
+      out.writeString(n);
+    }
+  }
+
+  std::vector<u8> quantized(parameterQuantized);
+  quantized.resize(numParameters, 0);
+
+  std::vector<u32> exactColumns;
+  std::vector<u32> quantizedColumns;
+
+  for (u32 i = 0; i < numParameters; ++i) {
+    (quantized[i] ? quantizedColumns : exactColumns).push_back(i);
+  }
+
+  size_t size = 64
+              + pluginID.getNumBytesAsUTF8()
+              + clips.size() * (sizeof(Point) + sizeof(PadPoint))
+              + clips.size() * (exactColumns.size() * sizeof(f32) + quantizedColumns.size() * sizeof(u16))
+              + paths.size() * sizeof(Point)
+              + numParameters * 3
+              + names.getSize()
+              + pluginData.getSize();
+
+  juce::MemoryOutputStream out(mb, false);
+  out.preallocate(size);
+
+  out.writeInt(magic);
+  out.writeInt(version);
+  out.writeInt(i32(clips.size()));
+  out.writeInt(i32(paths.size()));
+  out.writeInt(i32(numParameters));
+  out.writeFloat(zoom);
+  out.writeBool(editMode);
+  out.writeBool(discreteMode);
+  out.writeBool(quantizeClips);
+  out.writeBool(padMode);
+  out.writeFloat(padX);
+  out.writeFloat(padY);
+  out.writeString(pluginID);
+  out.writeInt64(i64(names.getSize()));
+  out.writeInt64(i64(pluginData.getSize()));
+
+  // NOTE(luca): the bulk sections are raw little-endian values, every platform we ship on is little-endian
+  out.write(clips.data(), clips.size() * sizeof(Point));
+
+  if (padPoints.size() == clips.size()) {
+    out.write(padPoints.data(), padPoints.size() * sizeof(PadPoint));
+  } else {
+    std::vector<PadPoint> unplaced(clips.size());
+    out.write(unplaced.data(), unplaced.size() * sizeof(PadPoint));
+  }
+
+  out.write(quantized.data(), quantized.size());
+
+  if (quantizedColumns.empty()) {
+    out.write(clipParameters.data(), clipParameters.size() * sizeof(f32));
+  } else {
+    std::vector<f32> exact(clips.size() * exactColumns.size());
+    std::vector<u16> fixed(clips.size() * quantizedColumns.size());
+
+    for (u32 c = 0; c < clips.size(); ++c) {
+      auto row = getClipParameters(c);
+      auto e = exact.data() + c * exactColumns.size();
+      auto q = fixed.data() + c * quantizedColumns.size();
+
+      for (u32 i = 0; i < exactColumns.size(); ++i) {
+        e[i] = row[exactColumns[i]];
+      }
+
+      for (u32 i = 0; i < quantizedColumns.size(); ++i) {
+        q[i] = u16(std::lround(row[quantizedColumns[i]] * 65535.f));
+      }
+    }
+
+    out.write(exact.data(), exact.size() * sizeof(f32));
+    out.write(fixed.data(), fixed.size() * sizeof(u16));
+  }
+
+  out.write(paths.data(), paths.size() * sizeof(Point));
+  out.write(parameterActive.data(), parameterActive.size());
+
+  std::vector<u8> curves(parameterCurves);
+  curves.resize(numParameters, 0);
+  out.write(curves.data(), curves.size());
+
+  out << names;
+  out << pluginData;
+}
+
+bool Session::read(const void* data, size_t size) {
+  juce::MemoryInputStream in(data, size, false);
+
+  if (size < 8 || in.readInt() != magic) {
+    return false;
+  }
+
+  i32 v = in.readInt();
+
+  if (v < 1 || v > version) {
+    return false;
+  }
+
+  u32 numClips = u32(in.readInt());
+  u32 numPaths = u32(in.readInt());
+  numParameters = u32(in.readInt());
+  zoom = in.readFloat();
+  editMode = in.readBool();
+  discreteMode = in.readBool();
+  quantizeClips = v >= 2 ? in.readBool() : false;
+  padMode = v >= 3 ? in.readBool() : false;
+  padX = v >= 3 ? in.readFloat() : 0.5f;
+  padY = v >= 3 ? in.readFloat() : 0.5f;
+  pluginID = in.readString();
+  i64 namesSize = in.readInt64();
+  i64 pluginDataSize = in.readInt64();
+
+  i64 flagsSize = v >= 2 ? i64(numParameters) : 0;
+  i64 padSize = v >= 3 ? i64(numClips) * i64(sizeof(PadPoint)) : 0;
+
+  if (namesSize < 0 || pluginDataSize < 0 || in.getNumBytesRemaining() < i64(numClips) * i64(sizeof(Point)) + padSize + flagsSize) {
+    return false;
+  }
+
+  clips.resize(numClips);
+  in.read(clips.data(), i32(clips.size() * sizeof(Point)));
+
+  padPoints.assign(numClips, {});
+
+  if (v >= 3) {
+    in.read(padPoints.data(), i32(padSize));
+  }
+
+  parameterQuantized.assign(numParameters, 0);
+
+  if (v >= 2) {
+    in.read(parameterQuantized.data(), i32(numParameters));
+  }
+
+  u32 numQuantized = u32(std::count_if(parameterQuantized.begin(), parameterQuantized.end(), [] (u8 q) { return q != 0; }));
+  u32 numExact = numParameters - numQuantized;
+
+  i64 expected = i64(numClips) * (i64(numExact) * i64(sizeof(f32)) + i64(numQuantized) * i64(sizeof(u16)))
+               + i64(numPaths) * i64(sizeof(Point))
+               + i64(numParameters) * (v >= 4 ? 2 : 1)
+               + namesSize
+               + pluginDataSize;
+
+  if (in.getNumBytesRemaining() < expected) {
+    return false;
+  }
+
+  clipParameters.resize(size_t(numClips) * numParameters);
+
+  if (numQuantized == 0) {
+    in.read(clipParameters.data(), i32(clipParameters.size() * sizeof(f32)));
+  } else {
+    std::vector<f32> exact(size_t(numClips) * numExact);
+    std::vector<u16> fixed(size_t(numClips) * numQuantized);
+    in.read(exact.data(), i32(exact.size() * sizeof(f32)));
+    in.read(fixed.data(), i32(fixed.size() * sizeof(u16)));
+
+    for (u32 c = 0; c < numClips; ++c) {
+      auto row = clipParameters.data() + size_t(c) * numParameters;
+      auto e = exact.data() + size_t(c) * numExact;
+      auto q = fixed.data() + size_t(c) * numQuantized;
+
+      for (u32 i = 0; i < numParameters; ++i) {
+        row[i] = parameterQuantized[i] ? f32(*q++) * (1.f / 65535.f) : *e++;
+      }
+    }
+  }
+
+  paths.resize(numPaths);
+  parameterActive.resize(numParameters);
+
+  in.read(paths.data(), i32(paths.size() * sizeof(Point)));
+  in.read(parameterActive.data(), i32(parameterActive.size()));
+
+  // NOTE(luca): left empty for older sessions so that the defaults picked for the plug-in stay
+  parameterCurves.clear();
+
+  if (v >= 4) {
+    parameterCurves.resize(numParameters);
+    in.read(parameterCurves.data(), i32(parameterCurves.size()));
+  }
+
+  {
+    juce::MemoryInputStream names(static_cast<const char*>(data) + in.getPosition(), size_t(namesSize), false);
+    parameterNames.clearQuick();
+    parameterNames.ensureStorageAllocated(i32(numParameters));
+
+    for (u32 i = 0; i < numParameters && !names.isExhausted(); ++i) {
+      parameterNames.add(names.readString());
+    }
+
+    in.skipNextBytes(namesSize);
+  }
+
+  pluginData.setSize(size_t(pluginDataSize));
+  in.read(pluginData.getData(), i32(pluginDataSize));
+
+  return parameterNames.size() == i32(numParameters);
+}
+
+bool Session::importLegacy(const juce::ValueTree& tree) {
+  if (!tree.isValid()) {
+    return false;
+  }
+
+  pluginID = tree["pluginID"];
+  zoom = tree.getProperty("zoom", 100);
+  editMode = tree["editMode"];
+  discreteMode = tree["discreteMode"];
+
+  if (auto mb = tree["pluginData"].getBinaryData()) {
+    pluginData = *mb;
+  }
+
+  auto parametersTree = tree.getChild(2);
+  numParameters = u32(parametersTree.getNumChildren());
+  parameterNames.clearQuick();
+  parameterActive.clear();
+  parameterQuantized.assign(numParameters, 0);
+
+  for (const auto& p : parametersTree) {
+    parameterNames.add(p["name"]);
+    parameterActive.push_back(bool(p["active"]));
+  }
+
+  auto clipsTree = tree.getChild(0);
+  clips.clear();
+  clipParameters.assign(size_t(clipsTree.getNumChildren()) * numParameters, 0);
+
+  for (const auto& c : clipsTree) {
+    clips.push_back({ c["x"], c["y"], c["c"] });
+
+    if (auto mb = c["parameters"].getBinaryData()) {
+      size_t n = std::min(mb->getSize() / sizeof(f32), size_t(numParameters));
+      std::memcpy(clipParameters.data() + (clips.size() - 1) * numParameters, mb->getData(), n * sizeof(f32));
+    }
+  }
+
+  auto pathsTree = tree.getChild(1);
+  paths.clear();
+
+  for (const auto& p : pathsTree) {
+    paths.push_back({ p["x"], p["y"], p["c"] });
+  }
+
+  return true;
+}
+
+} // namespace atmt
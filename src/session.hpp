@@ -0,0 +1,60 @@
+#pragma once
+
+#include <juce_data_structures/juce_data_structures.h>
+#include "types.hpp"
+#include <assert.h>
+
+namespace atmt {
+
+// NOTE(luca): flat snapshot of everything we persist. Clip parameters are kept as one
+// numClips * numParameters matrix so the whole thing is written and read with a handful of bulk copies.
+struct Session {
+  struct Point {
+    f32 x = 0;
+    f32 y = 0;
+    f32 c = 0.5;
+  };
+
+  static_assert(sizeof(Point) == sizeof(f32) * 3);
+
+  struct PadPoint {
+    f32 x = -1;
+    f32 y = -1;
+  };
+
+  static_assert(sizeof(PadPoint) == sizeof(f32) * 2);
+
+  juce::String pluginID;
+  juce::MemoryBlock pluginData;
+  f32 zoom = 100;
+  bool editMode = false;
+  bool discreteMode = false;
+  bool quantizeClips = false;
+  bool padMode = false;
+  f32 padX = 0.5f;
+  f32 padY = 0.5f;
+
+  u32 numParameters = 0;
+  std::vector<Point> clips;
+  std::vector<PadPoint> padPoints;
+  std::vector<f32> clipParameters;
+  std::vector<Point> paths;
+  juce::StringArray parameterNames;
+  std::vector<u8> parameterActive;
+  std::vector<u8> parameterQuantized;
+  std::vector<u8> parameterCurves;
+
+  bool isValid() const;
+  const f32* getClipParameters(u32) const;
+
+  void write(juce::MemoryBlock&) const;
+  bool read(const void*, size_t);
+  bool importLegacy(const juce::ValueTree&);
+
+  static constexpr i32 magic = 0x534d5441; // NOTE(luca): "ATMS"
+  // NOTE(luca): version 2 stores the columns flagged in parameterQuantized as a separate 16-bit matrix,
+  // version 3 adds the xy pad, version 4 the response curve of every parameter
+  static constexpr i32 version = 4;
+};
+
+} // namespace atmt
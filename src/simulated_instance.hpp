@@ -0,0 +1,111 @@
+#pragma once
+
+#include "plugin.hpp"
+#include <random>
+
+namespace atmt {
+
+// NOTE(luca): stands in for a hosted plug-in in the benchmark and the host simulator, N float parameters
+// and a gain on the first one so that processing touches the audio. Like plug-ins that sync their own
+// state late, every write is reported back rounded from processBlock, two writes behind.
+struct SimulatedInstance : juce::AudioPluginInstance {
+  struct Parameter : juce::AudioPluginInstance::HostedParameter {
+    Parameter(u32 i) : index(i) {}
+
+    f32 getValue() const override { return value; }
+    void setValue(f32 v) override { value = v; delayed = latest.exchange(v); }
+    f32 getDefaultValue() const override { return 0.5f; }
+    juce::String getName(i32) const override { return "Parameter " + juce::String(index); }
+    juce::String getLabel() const override { return {}; }
+    f32 getValueForText(const juce::String& text) const override { return text.getFloatValue(); }
+    juce::String getParameterID() const override { return juce::String(index); }
+
+    void echo() {
+      if (f32 v = delayed.exchange(-1); v >= 0) {
+        sendValueChangedMessageToListeners(std::round(v * 4096.f) / 4096.f);
+      }
+    }
+
+    u32 index = 0;
+    std::atomic<f32> value = 0.5f;
+    std::atomic<f32> latest = -1;
+    std::atomic<f32> delayed = -1;
+  };
+
+  SimulatedInstance(u32 numParameters) {
+    for (u32 i = 0; i < numParameters; ++i) {
+      addHostedParameter(std::make_unique<Parameter>(i));
+    }
+  }
+
+  void fillInPluginDescription(juce::PluginDescription& d) const override {
+    d.name = "Simulated";
+    d.pluginFormatName = "Internal";
+  }
+
+  void processBlock(juce::AudioBuffer<f32>& buffer, juce::MidiBuffer&) override {
+    for (auto* p : getParameters()) {
+      static_cast<Parameter*>(p)->echo();
+    }
+
+    if (!getParameters().isEmpty()) {
+      buffer.applyGain(getParameters().getUnchecked(0)->getValue());
+    }
+  }
+
+  const juce::String getName() const override { return "Simulated"; }
+  void prepareToPlay(f64, i32) override {}
+  void releaseResources() override {}
+  f64 getTailLengthSeconds() const override { return 0; }
+  bool acceptsMidi() const override { return false; }
+  bool producesMidi() const override { return false; }
+  juce::AudioProcessorEditor* createEditor() override { return nullptr; }
+  bool hasEditor() const override { return false; }
+  i32 getNumPrograms() override { return 1; }
+  i32 getCurrentProgram() override { return 0; }
+  void setCurrentProgram(i32) override {}
+  const juce::String getProgramName(i32) override { return {}; }
+  void changeProgramName(i32, const juce::String&) override {}
+  void getStateInformation(juce::MemoryBlock&) override {}
+  void setStateInformation(const void*, i32) override {}
+};
+
+// NOTE(luca): half the points are clips one beat apart on alternating lanes, the other half paths in
+// between. Every clip differs from the base snapshot in one parameter.
+static void populateTrack(StateManager& m, u32 numPoints, std::mt19937& rng) {
+  u32 numParameters = u32(m.parameters.size());
+  std::vector<f32> values(numParameters, 0.5f);
+  std::uniform_real_distribution<f32> unit(0, 1);
+
+  ScopedProcLock lk(m.proc);
+
+  u32 numClips = std::max(numPoints / 2, 2u);
+  m.clips.reserve(numClips);
+  m.paths.reserve(numPoints - numPoints / 2);
+
+  for (u32 i = 0; i < numClips; ++i) {
+    m.clips.emplace_back();
+    auto& clip = m.clips.back();
+    clip.x = f32(i * 2);
+    clip.y = f32(i % 2);
+
+    if (numParameters > 0) {
+      u32 p = i % numParameters;
+      values[p] = f32(i % 100) / 100.f;
+      m.captureClip(clip, values.data());
+      values[p] = 0.5f;
+    } else {
+      m.captureClip(clip, values.data());
+    }
+  }
+
+  for (u32 i = 0; i < numPoints - numPoints / 2; ++i) {
+    m.paths.push_back({ f32(i * 2 + 1), unit(rng), 0.5f });
+  }
+
+  m.markClipsDirty(0, u32(m.clips.size()));
+  m.markPathsDirty(0, u32(m.paths.size()));
+  m.updateTrack();
+}
+
+} // namespace atmt
@@ -4,6 +4,7 @@
 #include <assert.h>
 #include "scoped_timer.hpp"
 #include "logger.hpp"
+#include <unordered_map>
 
 namespace atmt {
 
@@ -11,6 +12,7 @@ StateManager::StateManager(juce::AudioProcessor& a) : proc(a) {}
 
 void StateManager::addClip(f32 x, f32 y, f32 curve) {
   JUCE_ASSERT_MESSAGE_THREAD
+  commitDragPreview();
 
   assert(x >= 0 && y >= 0 && y <= 1);
   assert(instance);
@@ -19,19 +21,23 @@ void StateManager::addClip(f32 x, f32 y, f32 curve) {
     ScopedProcLock lk(proc);
 
     clips.emplace_back();
+    markClipsDirty(u32(clips.size() - 1), u32(clips.size()));
     auto& clip = clips.back();
 
     clip.x = x;
     clip.y = y;
     clip.c = curve;
 
-    clip.parameters.reserve(parameters.size());
+    std::vector<f32> values;
+    values.reserve(parameters.size());
 
     for (auto& parameter : parameters) {
-      clip.parameters.push_back(parameter.parameter->getValue());
-      assert(isNormalised(clip.parameters.back()));
+      values.push_back(parameter.parameter->getValue());
     }
 
+    captureClip(clip, values.data());
+    insertPoint(true, u32(clips.size() - 1));
+
     if (selectedClipID != NONE) {
       selectClip(NONE);
     }
@@ -46,18 +52,23 @@ void StateManager::addClipDenorm(f32 x, f32 y, f32 curve) {
 
 void StateManager::duplicateClip(u32 id, f32 x, bool top) {
   JUCE_ASSERT_MESSAGE_THREAD
-  assert(instance && editor);
+  commitDragPreview();
+  assert(instance);
   assert(id < clips.size());
 
   {
     ScopedProcLock lk(proc);
 
     clips.push_back(clips[id]);
+    markClipsDirty(u32(clips.size() - 1), u32(clips.size()));
     auto& newClip = clips.back();
 
     newClip.x = x;
     newClip.y = f32(!top);
     newClip.c = 0.5f;
+    newClip.padX = -1;
+    newClip.padY = -1;
+    insertPoint(true, u32(clips.size() - 1));
 
     if (selectedClipID != NONE) {
       selectClip(NONE);
@@ -73,7 +84,7 @@ void StateManager::duplicateClip(u32 id, f32 x, bool top) {
 
 void StateManager::duplicateClipDenorm(u32 id, f32 x, bool top) {
   JUCE_ASSERT_MESSAGE_THREAD
-  assert(instance && editor);
+  assert(instance);
   assert(id < clips.size());
 
   duplicateClip(id, grid.snap(x) / zoom, top);
@@ -81,16 +92,27 @@ void StateManager::duplicateClipDenorm(u32 id, f32 x, bool top) {
 
 void StateManager::moveClip(u32 id, f32 x, f32 y, f32 curve) {
   JUCE_ASSERT_MESSAGE_THREAD
-  assert(instance && editor);
+  assert(instance);
   assert(id < clips.size());
 
+  x = x < 0 ? 0 : x;
+  y = std::clamp(y, 0.f, 1.f);
+  curve = std::clamp(curve, 0.f, 1.f);
+
+  if (dragPreview.active) {
+    previewAutomationPoint(findClipPoint(id), x, y, curve);
+    return;
+  }
+
   if (neqf32(clips[id].x, x) || neqf32(clips[id].y, y) || neqf32(clips[id].c, curve)) {
     {
       ScopedProcLock lk(proc);
 
-      clips[id].x = x < 0 ? 0 : x;
-      clips[id].y = std::clamp(y, 0.f, 1.f);
-      clips[id].c = std::clamp(curve, 0.f, 1.f);
+      clips[id].x = x;
+      clips[id].y = y;
+      clips[id].c = curve;
+      markClipsDirty(id, id + 1);
+      updatePoint(true, id);
 
       updateTrack();
     }
@@ -107,26 +129,35 @@ void StateManager::moveClipDenorm(u32 id, f32 x, f32 y, f32 curve) {
 }
 
 void StateManager::selectClip(i32 id) {
-  assert(instance && editor);
+  assert(instance);
   assert(id < i32(clips.size()));
 
   selectedClipID = id;
 
   if (editMode && id != NONE) {
-    engine->setParameters(clips[u32(id)].parameters, parameters);
+    std::vector<f32> values(parameters.size());
+    clips[u32(id)].expand(values.data());
+    engine->setParameters(values, parameters);
   }
 
-  updateTrackView();
+  if (trackView) {
+    updateTrackView();
+  }
 }
 
 void StateManager::removeClip(u32 id) {
   JUCE_ASSERT_MESSAGE_THREAD
-  assert(instance && editor);
+  endRemovalPreview();
+  assert(instance);
   assert(id < clips.size());
 
+  [[maybe_unused]] size_t steps = history.undo.size();
+
   {
     ScopedProcLock lk(proc);
+    markClipsDirty(id, u32(clips.size()));
     clips.erase(clips.begin() + id);
+    erasePoint(true, id);
 
     if (selectedClipID != NONE) {
       selectClip(NONE);
@@ -135,6 +166,8 @@ void StateManager::removeClip(u32 id) {
     updateTrack();
   }
 
+  assert(history.undo.size() == std::min(steps + 1, size_t(History::maxSteps)));
+
   if (editMode && !clips.empty()) {
     engine->interpolate();
   }
@@ -142,16 +175,19 @@ void StateManager::removeClip(u32 id) {
 
 u32 StateManager::addPath(f32 x, f32 y, f32 curve) {
   JUCE_ASSERT_MESSAGE_THREAD
+  commitDragPreview();
   assert(instance);
   assert(x >= 0 && isNormalised(y) && isNormalised(curve));
 
   {
     ScopedProcLock lk(proc);
     paths.emplace_back();
+    markPathsDirty(u32(paths.size() - 1), u32(paths.size()));
     auto& path = paths.back();
     path.x = x;
     path.y = y;
     path.c = curve;
+    insertPoint(false, u32(paths.size() - 1));
 
     if (selectedClipID != NONE) {
       selectClip(NONE);
@@ -175,7 +211,7 @@ u32 StateManager::addPathDenorm(f32 x, f32 y, f32 curve) {
 
 void StateManager::movePath(u32 id, f32 x, f32 y, f32 c) {
   JUCE_ASSERT_MESSAGE_THREAD
-  assert(instance && editor);
+  assert(instance);
   assert(id < paths.size());
 
   // TODO(luca): trackwidth
@@ -183,12 +219,23 @@ void StateManager::movePath(u32 id, f32 x, f32 y, f32 c) {
   y = std::clamp(y, 0.f, 1.f);
   c = std::clamp(c, 0.f, 1.f);
 
+  if (dragPreview.active) {
+    if (selectedClipID != NONE) {
+      selectClip(NONE);
+    }
+
+    previewAutomationPoint(findPathPoint(id), x, y, c);
+    return;
+  }
+
   if (neqf32(x, paths[id].x) || neqf32(y, paths[id].y) || neqf32(c, paths[id].c)) {
     {
       ScopedProcLock lk(proc);
       paths[id].x = x;
       paths[id].y = y;
       paths[id].c = c;
+      markPathsDirty(id, id + 1);
+      updatePoint(false, id);
 
       if (selectedClipID != NONE) {
         selectClip(NONE);
@@ -211,12 +258,17 @@ void StateManager::movePathDenorm(u32 id, f32 x, f32 y, f32 c) {
 
 void StateManager::removePath(u32 id) {
   JUCE_ASSERT_MESSAGE_THREAD
-  assert(instance && editor);
+  endRemovalPreview();
+  assert(instance);
   assert(id < paths.size());
 
+  [[maybe_unused]] size_t steps = history.undo.size();
+
   {
     ScopedProcLock lk(proc);
+    markPathsDirty(id, u32(paths.size()));
     paths.erase(paths.begin() + id);
+    erasePoint(false, id);
 
     if (selectedClipID != NONE) {
       selectClip(NONE);
@@ -225,13 +277,15 @@ void StateManager::removePath(u32 id) {
     updateTrack();
   }
 
+  assert(history.undo.size() == std::min(steps + 1, size_t(History::maxSteps)));
+
   if (editMode && !clips.empty()) {
     engine->interpolate();
   }
 }
 
 void StateManager::bendAutomation(f32 position, f32 amount) {
-  assert(instance && editor);
+  assert(instance);
   assert(position >= 0);
 
   i32 pointIndex = findAutomationPoint(position);
@@ -240,11 +294,9 @@ void StateManager::bendAutomation(f32 position, f32 amount) {
 
   auto& point = points[u32(pointIndex)];
 
-  assert(point.clip || point.path);
-
   f32 curve = std::clamp(point.c + amount, 0.f, 1.f);
 
-  if (point.clip) {
+  if (point.isClip) {
     moveClip(point.id, point.x, point.y, curve);
   } else {
     movePath(point.id, point.x, point.y, curve);
@@ -256,7 +308,7 @@ void StateManager::bendAutomationDenorm(f32 position, f32 amount) {
 }
 
 void StateManager::flattenAutomationCurve(f32 position) {
-  assert(instance && editor);
+  assert(instance);
   assert(position >= 0);
  
   i32 pointIndex = findAutomationPoint(position);
@@ -264,9 +316,8 @@ void StateManager::flattenAutomationCurve(f32 position) {
 
   if (pointIndex != NONE) {
     const auto& point = points[u32(pointIndex)];
-    assert(point.clip || point.path);
 
-    if (point.path) {
+    if (!point.isClip) {
       movePath(point.id, point.x, point.y, 0.5f);
     } else {
       moveClip(point.id, point.x, point.y, 0.5f);
@@ -279,7 +330,7 @@ void StateManager::flattenAutomationCurveDenorm(f32 position) {
 }
 
 void StateManager::dragAutomationSection(f32 position, f32 amount) {
-  assert(instance && editor);
+  assert(instance);
 
   i32 pointIndex_ = findAutomationPoint(position);
 
@@ -287,18 +338,16 @@ void StateManager::dragAutomationSection(f32 position, f32 amount) {
   u32 pointIndex = u32(pointIndex_);
 
   const auto& point = points[pointIndex];
-  assert(point.clip || point.path);
-
   f32 y = std::clamp(point.y - amount, 0.f, 1.f);
 
-  if (point.path) {
+  if (!point.isClip) {
     movePath(point.id, point.x, y, point.c);
   }
 
   if (pointIndex != 0 && pointIndex + 1 != points.size() - 1) {
     const auto& prev = points[pointIndex - 1];
 
-    if (prev.path) {
+    if (!prev.isClip) {
       y = std::clamp(prev.y - amount, 0.f, 1.f);
       movePath(prev.id, prev.x, y, prev.c);
     }
@@ -310,361 +359,1344 @@ void StateManager::dragAutomationSectionDenorm(f32 position, f32 amount) {
 }
 
 i32 StateManager::findAutomationPoint(f32 x) {
-  assert(instance && editor);
+  assert(instance);
   assert(x >= 0);
 
-  for (u32 i = 0; i < points.size(); ++i) {
-    if (i != 0) {
-      if (x >= points[i - 1].x && x <= points[i].x) {
-        return i32(i);
-      } 
-    } else if (x <= points[i].x) {
-      return i32(i);
-    }
-  }
-
-  if (points.size() > 0) {
-    return i32(points.size() - 1);
+  if (points.empty()) {
+    return NONE;
   }
 
-  return NONE;
+  auto it = std::lower_bound(points.begin(), points.end(), x, [] (const AutomationPoint& p, f32 v) { return p.x < v; });
+  return it != points.end() ? i32(it - points.begin()) : i32(points.size() - 1);
 }
 
 i32 StateManager::findAutomationPointDenorm(f32 x) {
   return findAutomationPoint(grid.snap(x) / zoom);
 }
 
-void StateManager::doZoom(f32 amount, i32 position) {
-  JUCE_ASSERT_MESSAGE_THREAD
-  assert(instance && editor && trackView);
-
-  {
-    f32 z0 = zoom;
-    f32 z1 = z0 + (amount * kZoomSpeed * (z0 / kZoomDeltaScale)); 
+AutomationPoint* StateManager::findClipPoint(u32 id) {
+  assert(id < clipPoints.size());
+  return &points[clipPoints[id]];
+}
 
-    z1 = std::clamp(z1, 0.001f, 10000.f);
-    zoom = z1;
+AutomationPoint* StateManager::findPathPoint(u32 id) {
+  assert(id < pathPoints.size());
+  return &points[pathPoints[id]];
+}
 
-    f32 x0 = -viewportDeltaX;
-    f32 x1 = position;
-    f32 d = x1 - x0;
-    f32 p = x1 / z0;
-    f32 X1 = p * z1;
-    f32 X0 = X1 - d;
+void StateManager::beginDragPreview() {
+  JUCE_ASSERT_MESSAGE_THREAD
+  dragPreview.active = true;
+}
 
-    updateTrackWidth();
-    assert(trackWidth >= kWidth);
+void StateManager::endDragPreview() {
+  JUCE_ASSERT_MESSAGE_THREAD
+  commitDragPreview();
+  dragPreview.active = false;
+  commitUndoStep();
+}
 
-    viewportDeltaX = std::clamp(i32(-X0), -(trackWidth - kWidth), 0);
-    assert(viewportDeltaX <= 0);
+// NOTE(luca): a removal ends whatever drag was going on, the point being dragged may be the one that goes
+// away and its view with it. The drag is committed as its own step first.
+void StateManager::endRemovalPreview() {
+  JUCE_ASSERT_MESSAGE_THREAD
 
-    updateGrid();
-    updateTrackView();
-    updateAutomationView();
+  if (dragPreview.active) {
+    endDragPreview();
+  } else {
+    commitDragPreview();
   }
-  
-  trackView->playhead.x = playheadPosition.load() * zoom;
-  trackView->setTopLeftPosition(viewportDeltaX, trackView->getY());
 }
 
-void StateManager::doScroll(f32 amount) {
+void StateManager::commitDragPreview() {
   JUCE_ASSERT_MESSAGE_THREAD
-  assert(instance && editor && trackView);
 
-  viewportDeltaX += i32(amount * kScrollSpeed);
-  viewportDeltaX = std::clamp(viewportDeltaX, -(trackWidth - kWidth), 0);
-  trackView->setTopLeftPosition(viewportDeltaX, trackView->getY());
-}
+  if (!dragPreview.dirty) {
+    return;
+  }
 
-void StateManager::setEditMode(bool m) {
-  JUCE_ASSERT_MESSAGE_THREAD
+  dragPreview.dirty = false;
 
-  editMode = m;
+  {
+    ScopedProcLock lk(proc);
 
-  if (toolBarView) {
-    updateToolBarView();
+    // NOTE(luca): structural edits always commit the preview first, so point ids still match the vectors
+    for (const auto& point : points) {
+      if (point.isClip) {
+        auto& clip = clips[point.id];
+
+        if (neqf32(clip.x, point.x) || neqf32(clip.y, point.y) || neqf32(clip.c, point.c)) {
+          markClipsDirty(point.id, point.id + 1);
+        }
+
+        if (neqf32(clip.y, point.y)) {
+          markLerpPairsDirty(point.id);
+        }
+
+        clip.x = point.x;
+        clip.y = point.y;
+        clip.c = point.c;
+      } else {
+        auto& path = paths[point.id];
+
+        if (neqf32(path.x, point.x) || neqf32(path.y, point.y) || neqf32(path.c, point.c)) {
+          markPathsDirty(point.id, point.id + 1);
+        }
+
+        path.x = point.x;
+        path.y = point.y;
+        path.c = point.c;
+      }
+    }
+
+    pointsInSync = true;
+    updateTrack();
+  }
+
+  if (editMode && !clips.empty()) {
+    engine->interpolate();
   }
 }
 
-void StateManager::setDiscreteMode(bool m) {
+void StateManager::previewAutomationPoint(AutomationPoint* point, f32 x, f32 y, f32 c) {
   JUCE_ASSERT_MESSAGE_THREAD
+  assert(point);
 
-  discreteMode = m;
+  if (neqf32(point->x, x) || neqf32(point->y, y) || neqf32(point->c, c)) {
+    bool reorder = neqf32(point->x, x);
 
-  if (toolBarView) {
-    updateToolBarView();
+    point->x = x;
+    point->y = y;
+    point->c = c;
+
+    // NOTE(luca): only reorder when the point moved in time so that indices handed out by
+    // findAutomationPoint stay valid while bending or dragging a section
+    if (reorder) {
+      sortPoint(u32(point - points.data()));
+    }
+
+    dragPreview.dirty = true;
+    updateDragPreviewView();
+    wakeTimer();
   }
 }
 
-void StateManager::setSelection(f32 start, f32 end) {
-  JUCE_ASSERT_MESSAGE_THREAD
-  assert(instance && editor && trackView);
-  assert(start >= 0 && end >= 0);
+static void markDirty(std::vector<bool>& dirty, u32 begin, u32 end, u32 chunkSize) {
+  if (begin >= end) {
+    return;
+  }
 
-  selection.start = start; 
-  selection.end = end;
+  u32 last = (end - 1) / chunkSize;
 
-  automationView->selection.start = selection.start * zoom;
-  automationView->selection.end = selection.end * zoom;
+  if (dirty.size() <= last) {
+    dirty.resize(last + 1, false);
+  }
 
-  updateTrack();
+  for (u32 c = begin / chunkSize; c <= last; ++c) {
+    dirty[c] = true;
+  }
 }
 
-void StateManager::setSelectionDenorm(f32 start, f32 end) {
-  setSelection(grid.snap(start) / zoom, grid.snap(end) / zoom);
+void StateManager::markClipsDirty(u32 begin, u32 end) {
+  ++stateGeneration;
+  markDirty(history.dirtyClips, begin, end, PersistentVector<Clip>::chunkSize);
 }
 
-void StateManager::removeSelection() {
+void StateManager::markPathsDirty(u32 begin, u32 end) {
+  ++stateGeneration;
+  markDirty(history.dirtyPaths, begin, end, PersistentVector<Path>::chunkSize);
+}
+
+void StateManager::commitUndoStep() {
   JUCE_ASSERT_MESSAGE_THREAD
-  assert(instance && editor && trackView);
-  assert(selection.start >= 0 && selection.end >= 0);
 
-  if (selection.start > selection.end) {
-    std::swap(selection.start, selection.end);
+  auto& h = history;
+  auto isDirty = [] (const std::vector<bool>& d) { return std::find(d.begin(), d.end(), true) != d.end(); };
+
+  bool dirty = h.dirtyActive || quantizeClips != h.current.quantizeClips
+            || isDirty(h.dirtyClips) || clips.size() != h.current.clips.size
+            || isDirty(h.dirtyPaths) || paths.size() != h.current.paths.size;
+
+  if (!dirty) {
+    return;
   }
 
-  if (std::abs(selection.start - selection.end) > EPSILON) {
-    ScopedProcLock lk(proc);
+  Document next;
+  next.clips = PersistentVector<Clip>::update(h.current.clips, clips, h.dirtyClips);
+  next.paths = PersistentVector<Path>::update(h.current.paths, paths, h.dirtyPaths);
+  next.active = h.current.active;
+  next.quantizeClips = quantizeClips;
 
-    std::erase_if(clips, [this] (const Clip& c) { return c.x >= selection.start && c.x <= selection.end; }); 
-    std::erase_if(paths, [this] (const Path& p) { return p.x >= selection.start && p.x <= selection.end; }); 
+  if (h.dirtyActive) {
+    auto active = std::make_shared<std::vector<bool>>(parameters.size());
+
+    for (u32 i = 0; i < parameters.size(); ++i) {
+      (*active)[i] = parameters[i].active;
+    }
+
+    next.active = std::move(active);
   }
 
-  updateTrack();
+  h.undo.push_back(std::move(h.current));
+
+  if (h.undo.size() > History::maxSteps) {
+    h.undo.erase(h.undo.begin());
+  }
+
+  h.current = std::move(next);
+  h.redo.clear();
+  h.dirtyClips.clear();
+  h.dirtyPaths.clear();
+  h.dirtyActive = false;
+
+  journal.push(h.current);
 }
 
-void StateManager::setPlayheadPosition(f32 x) {
+void StateManager::resetHistory() {
   JUCE_ASSERT_MESSAGE_THREAD
-  assert(instance && editor && trackView && automationView);
-  assert(x >= 0);
-  assert(editMode);
 
-  if (neqf32(playheadPosition, x)) {
-    playheadPosition = x;
+  history = {};
+  history.dirtyActive = true;
+  markClipsDirty(0, u32(clips.size()));
+  markPathsDirty(0, u32(paths.size()));
+  commitUndoStep();
+  history.undo.clear();
+}
 
-    if (trackView) {
-      trackView->playhead.x = playheadPosition * zoom;
-      trackView->repaint();
+void StateManager::applyDocument(const Document& d) {
+  JUCE_ASSERT_MESSAGE_THREAD
+  assert(instance);
+
+  auto& h = history;
+
+  {
+    ScopedProcLock lk(proc);
+
+    d.clips.apply(h.current.clips, clips);
+    d.paths.apply(h.current.paths, paths);
+
+    if (d.active != h.current.active && d.active) {
+      for (u32 i = 0; i < parameters.size() && i < d.active->size(); ++i) {
+        parameters[i].active = (*d.active)[i];
+      }
+
+      if (parametersView) {
+        for (u32 i = 0; i < parameters.size(); ++i) {
+          parametersView->active[i] = parameters[i].active;
+        }
+
+        parametersView->repaint();
+      }
     }
 
-    if (!clips.empty()) {
-      engine->interpolate();
+    if (d.quantizeClips != quantizeClips) {
+      quantizeClips = d.quantizeClips;
+      updateQuantizedParameters();
     }
+
+    h.current = d;
+    journal.push(h.current);
+    ++stateGeneration;
+    selectedClipID = NONE;
+    engine->lastVisitedPair = UNDEFINED_PAIR;
+
+    [[maybe_unused]] size_t steps = h.undo.size();
+    [[maybe_unused]] size_t redoSteps = h.redo.size();
+
+    updateTrack();
+
+    // NOTE(luca): applying a document must never become a step of its own
+    assert(h.undo.size() == steps && h.redo.size() == redoSteps);
   }
 
-  selectClip(NONE);
+  if (editMode && !clips.empty()) {
+    engine->interpolate();
+  }
 }
 
-void StateManager::setPlayheadPositionDenorm(f32 x) {
-  setPlayheadPosition(grid.snap(x) / zoom);
-}
+void StateManager::undo() {
+  JUCE_ASSERT_MESSAGE_THREAD
+  commitDragPreview();
+  commitUndoStep();
 
-bool StateManager::shouldProcessParameter(u32 index) {
-  if (parameters[index].active && parameters[index].parameter->isAutomatable()) {
-    return parameters[index].parameter->isDiscrete() ? discreteMode.load() : true; 
+  auto& h = history;
+
+  if (h.undo.empty()) {
+    return;
   }
 
-  return false;
+  auto d = std::move(h.undo.back());
+  h.undo.pop_back();
+  h.redo.push_back(h.current);
+  applyDocument(d);
 }
 
-void StateManager::movePlayheadForward() {
-  if (editMode) {
-    f32 pos = playheadPosition * zoom;
+void StateManager::redo() {
+  JUCE_ASSERT_MESSAGE_THREAD
+  commitDragPreview();
+  commitUndoStep();
 
-    if (grid.snapOn) {
-      pos += grid.snapInterval;  
-    } else {
-      pos += 1;
-    }
+  auto& h = history;
 
-    setPlayheadPositionDenorm(pos);
+  if (h.redo.empty()) {
+    return;
   }
+
+  auto d = std::move(h.redo.back());
+  h.redo.pop_back();
+  h.undo.push_back(h.current);
+  applyDocument(d);
 }
 
-void StateManager::movePlayheadBack() {
-  if (editMode) {
-    f32 pos = playheadPosition * zoom;
+Journal::Settings StateManager::getJournalSettings() {
+  JUCE_ASSERT_MESSAGE_THREAD
 
-    if (grid.snapOn) {
-      pos -= grid.snapInterval;  
-    } else {
-      pos -= 1;
-    }
-    
-    if (pos >= 0) {
-      setPlayheadPositionDenorm(pos);
-    }
+  Journal::Settings settings;
+  settings.zoom = zoom;
+  settings.editMode = editMode;
+  settings.discreteMode = discreteMode;
+  settings.padMode = padMode;
+  settings.padX = padX->get();
+  settings.padY = padY->get();
+  settings.parameterQuantized.reserve(parameters.size());
+  settings.parameterCurves.reserve(parameters.size());
+
+  for (u32 i = 0; i < parameters.size(); ++i) {
+    settings.parameterQuantized.push_back(quantizedParameters[i]);
+    settings.parameterCurves.push_back(u8(parameters[i].curve));
   }
+
+  return settings;
 }
 
-void StateManager::randomiseParameters() {
+Journal::Meta StateManager::getJournalMeta() {
   JUCE_ASSERT_MESSAGE_THREAD
 
+  Journal::Meta meta;
+
+  if (instance) {
+    instance->getStateInformation(meta.pluginData);
+  }
+
+  meta.pluginID = pluginID;
+  meta.settings = getJournalSettings();
+
   for (u32 i = 0; i < parameters.size(); ++i) {
-    if (shouldProcessParameter(i)) {
-      parameters[i].parameter->setValueNotifyingHost(random(randomSpread));
-    }
+    meta.parameterNames.add(parameters[i].parameter->getName(1024));
   }
+
+  return meta;
 }
 
-void StateManager::setAllParametersActive(bool v) {
+void StateManager::recoverSession() {
   JUCE_ASSERT_MESSAGE_THREAD
 
-  {
-    ScopedProcLock lk(proc);
+  auto orphans = Journal::findOrphans();
 
-    for (u32 i = 0; i < parameters.size(); ++i) {
-      setParameterActive(i, v);
-    }
+  if (orphans.empty()) {
+    return;
+  }
+
+  // NOTE(luca): orphans come newest first. The journal is only deleted once the plug-in it belongs to
+  // has loaded, a failed load leaves it to be recovered again.
+  const auto& orphan = orphans.front();
+  auto session = std::make_unique<Session>();
+
+  if (Journal::recover(orphan, *session)) {
+    Logger::info("Recovering session from " + orphan.getFullPathName());
+    replace(std::move(session));
+    recoveredJournal = orphan;
+  } else {
+    Logger::warn("Failed to recover session from " + orphan.getFullPathName());
+    orphan.deleteFile();
   }
 }
 
-void StateManager::setParameterActive(u32 index, bool a) {
+void StateManager::doZoom(f32 amount, i32 position) {
   JUCE_ASSERT_MESSAGE_THREAD
+  commitDragPreview();
+  assert(instance);
 
   {
-    ScopedProcLock lk(proc);
-    parameters[index].active = a;
-  }
-}
+    f32 z0 = zoom;
+    f32 z1 = z0 + (amount * kZoomSpeed * (z0 / kZoomDeltaScale)); 
+
+    z1 = std::clamp(z1, 0.001f, 10000.f);
+    zoom = z1;
+    ++stateGeneration;
 
-void StateManager::parameterValueChanged(i32 i, f32) {
-  DBG("Parameter " + parameters[u32(i)].parameter->getName(1024) + " at index " + juce::String(i) + " changed.");
+    f32 x0 = -viewportDeltaX;
+    f32 x1 = position;
+    f32 d = x1 - x0;
+    f32 p = x1 / z0;
+    f32 X1 = p * z1;
+    f32 X0 = X1 - d;
 
-  auto sendParameterUpdate = [this, i] {
-    engine->lastVisitedPair = UNDEFINED_PAIR; 
+    updateTrackWidth();
+    assert(trackWidth >= kWidth);
 
-    if (captureParameterChanges) {
-      setParameterActive(u32(i), true);
-    } else if (releaseParameterChanges) {
-      setParameterActive(u32(i), false);
-    }
+    viewportDeltaX = std::clamp(i32(-X0), -(trackWidth - kWidth), 0);
+    assert(viewportDeltaX <= 0);
+  }
 
-    if (shouldProcessParameter(u32(i))) {
-      if (!editMode) {
-        setEditMode(true);
-      } else if (selectedClipID != NONE) {
-        clips[u32(selectedClipID)].parameters[u32(i)] = parameters[u32(i)].parameter->getValue();
+  if (trackView) {
+    updateGrid();
+    updateTrackView();
+    updateAutomationView();
 
-        if (clips.size() > 1) {
-          updateLerpPairs();
-        }
-      }
-    }
-  };
+    trackView->playhead.x = playheadPosition.load() * zoom;
+    trackView->setTopLeftPosition(viewportDeltaX, trackView->getY());
+  }
+}
+
+void StateManager::doScroll(f32 amount) {
+  JUCE_ASSERT_MESSAGE_THREAD
+  assert(instance);
+
+  // NOTE(luca): without an editor nothing has worked out the track width yet, clamp needs it to be at
+  // least kWidth
+  if (trackWidth < kWidth) {
+    updateTrackWidth();
+  }
+
+  viewportDeltaX += i32(amount * kScrollSpeed);
+  viewportDeltaX = std::clamp(viewportDeltaX, -(trackWidth - kWidth), 0);
+
+  if (trackView) {
+    trackView->setTopLeftPosition(viewportDeltaX, trackView->getY());
+  }
+}
+
+void StateManager::setEditMode(bool m) {
+  JUCE_ASSERT_MESSAGE_THREAD
+
+  editMode = m;
+  ++stateGeneration;
+
+  if (toolBarView) {
+    updateToolBarView();
+  }
+}
+
+void StateManager::setDiscreteMode(bool m) {
+  JUCE_ASSERT_MESSAGE_THREAD
+
+  discreteMode = m;
+  ++stateGeneration;
+
+  if (toolBarView) {
+    updateToolBarView();
+  }
+}
+
+void StateManager::setQuantizeClips(bool q) {
+  JUCE_ASSERT_MESSAGE_THREAD
+  commitDragPreview();
+
+  if (q == quantizeClips) {
+    return;
+  }
+
+  {
+    ScopedProcLock lk(proc);
+
+    quantizeClips = q;
+    ++stateGeneration;
+    updateQuantizedParameters();
+
+    std::vector<f32> values(parameters.size());
+    markClipsDirty(0, u32(clips.size()));
+
+    for (auto& clip : clips) {
+      clip.expand(values.data());
+      clip.setParameters(clip.base, values.data(), quantizedParameters);
+    }
+
+    if (instance) {
+      updateTrack();
+    }
+  }
+}
+
+void StateManager::setRecordMode(bool m) {
+  JUCE_ASSERT_MESSAGE_THREAD
+
+  if (!m && recordParameter != NONE) {
+    finishRecording();
+  }
+
+  recordMode = m;
+}
+
+// NOTE(luca): the take replaces whatever automation was under it, one undo step per take
+void StateManager::finishRecording() {
+  JUCE_ASSERT_MESSAGE_THREAD
+
+  ScopedProcLock lk(proc);
+
+  // NOTE(luca): with processing suspended nothing can be pushed after the last drain
+  recordParameter = NONE;
+  auto take = recorder.finish();
+
+  if (take.size() < 2) {
+    return;
+  }
+
+  f32 start = take.front().x;
+  f32 end = take.back().x;
+
+  auto first = std::find_if(paths.begin(), paths.end(), [=] (const Path& p) { return p.x >= start && p.x <= end; });
+  markPathsDirty(u32(first - paths.begin()), u32(paths.size()));
+
+  paths.erase(std::remove_if(first, paths.end(), [=] (const Path& p) { return p.x >= start && p.x <= end; }), paths.end());
+  paths.insert(paths.end(), take.begin(), take.end());
+  markPathsDirty(u32(paths.size() - take.size()), u32(paths.size()));
+
+  if (selectedClipID != NONE) {
+    selectClip(NONE);
+  }
+
+  updateTrack();
+}
+
+void StateManager::setPadMode(bool m) {
+  JUCE_ASSERT_MESSAGE_THREAD
+  commitDragPreview();
+
+  if (m == padMode) {
+    return;
+  }
+
+  {
+    ScopedProcLock lk(proc);
+
+    padMode = m;
+    ++stateGeneration;
+    engine->lastVisitedPair = UNDEFINED_PAIR;
+
+    if (instance) {
+      updateTrack();
+    }
+  }
+
+  if (editor && instance) {
+    editor->mainView.setPadMode(m);
+  }
+
+  if (editMode && instance && !clips.empty()) {
+    engine->interpolate();
+  }
+}
+
+void StateManager::setPadPosition(f32 x, f32 y) {
+  JUCE_ASSERT_MESSAGE_THREAD
+
+  padXAttachment->setValueAsPartOfGesture(std::clamp(x, 0.f, 1.f));
+  padYAttachment->setValueAsPartOfGesture(std::clamp(y, 0.f, 1.f));
+}
+
+void StateManager::beginPadGesture() {
+  JUCE_ASSERT_MESSAGE_THREAD
+
+  padXAttachment->beginGesture();
+  padYAttachment->beginGesture();
+}
+
+void StateManager::endPadGesture() {
+  JUCE_ASSERT_MESSAGE_THREAD
+
+  padXAttachment->endGesture();
+  padYAttachment->endGesture();
+}
+
+// NOTE(luca): called on the message thread for both our own gestures and host automation. Outside of edit
+// mode the engine picks the new position up on the next block.
+void StateManager::padPositionChanged() {
+  JUCE_ASSERT_MESSAGE_THREAD
+
+  ++stateGeneration;
+
+  if (padMode && editMode && instance && !clips.empty()) {
+    engine->interpolate();
+  }
+
+  if (padView) {
+    updatePadView();
+  }
+}
+
+void StateManager::movePadPoint(u32 id, f32 x, f32 y) {
+  JUCE_ASSERT_MESSAGE_THREAD
+  assert(id < clips.size());
+
+  {
+    ScopedProcLock lk(proc);
+
+    auto& clip = clips[id];
+    clip.padX = std::clamp(x, 0.f, 1.f);
+    clip.padY = std::clamp(y, 0.f, 1.f);
+    markClipsDirty(id, id + 1);
+
+    engine->updatePadRow(id);
+    engine->lastVisitedPair = UNDEFINED_PAIR;
+  }
+
+  if (padView) {
+    updatePadView();
+  }
+
+  if (editMode && !clips.empty()) {
+    engine->interpolate();
+  }
+}
+
+// NOTE(luca): clips that were never placed on the pad are spread around its centre. The layout only
+// depends on the clips so it isn't an edit of its own: it doesn't mark history dirty, otherwise undoing to
+// a document from before pad mode would push a new step and lose the redo stack.
+void StateManager::layoutPadPoints() {
+  u32 numClips = u32(clips.size());
+
+  for (u32 i = 0; i < numClips; ++i) {
+    auto& clip = clips[i];
+
+    if (clip.padX < 0 || clip.padY < 0) {
+      f32 angle = 2 * f32(std::numbers::pi) * f32(i) / f32(numClips);
+      clip.padX = 0.5f + kPadLayoutRadius * std::cos(angle);
+      clip.padY = 0.5f + kPadLayoutRadius * std::sin(angle);
+      ++stateGeneration;
+    }
+  }
+}
+
+void StateManager::updateParametersView() {
+  assert(parametersView);
+
+  juce::StringArray names;
+  names.ensureStorageAllocated(i32(parameters.size()));
+
+  for (const auto& p : parameters) {
+    names.add(p.parameter->getName(1024));
+  }
+
+  parametersView->setParameters(names);
+
+  for (u32 i = 0; i < parameters.size(); ++i) {
+    parametersView->values[i] = parameters[i].parameter->getValue();
+    parametersView->active[i] = parameters[i].active;
+    parametersView->curves[i] = u8(parameters[i].curve);
+  }
+
+  parametersView->repaint();
+}
+
+void StateManager::toggleParametersView() {
+  JUCE_ASSERT_MESSAGE_THREAD
+  assert(parametersView);
+
+  // NOTE(luca): the feed is only drained while the panel is showing
+  for (u32 i = 0; i < parameters.size(); ++i) {
+    parametersView->values[i] = parameters[i].parameter->getValue();
+  }
+
+  editor->mainView.toggleParametersView();
+}
+
+void StateManager::updatePadView() {
+  assert(padView);
+
+  u32 numClips = u32(clips.size());
+  padView->points.resize(numClips);
+
+  for (u32 i = 0; i < numClips; ++i) {
+    padView->points[i] = { clips[i].padX, clips[i].padY };
+  }
+
+  padView->position = { padX->get(), padY->get() };
+  padView->repaint();
+}
+
+void StateManager::setSelection(f32 start, f32 end) {
+  JUCE_ASSERT_MESSAGE_THREAD
+  commitDragPreview();
+  assert(instance);
+  assert(start >= 0 && end >= 0);
+
+  selection.start = start; 
+  selection.end = end;
+
+  if (automationView) {
+    automationView->selection.start = selection.start * zoom;
+    automationView->selection.end = selection.end * zoom;
+  }
+
+  updateTrack();
+}
+
+void StateManager::setSelectionDenorm(f32 start, f32 end) {
+  setSelection(grid.snap(start) / zoom, grid.snap(end) / zoom);
+}
+
+void StateManager::removeSelection() {
+  JUCE_ASSERT_MESSAGE_THREAD
+  commitDragPreview();
+  assert(instance);
+  assert(selection.start >= 0 && selection.end >= 0);
+
+  if (selection.start > selection.end) {
+    std::swap(selection.start, selection.end);
+  }
+
+  if (std::abs(selection.start - selection.end) > EPSILON) {
+    ScopedProcLock lk(proc);
+
+    auto inSelection = [this] (const auto& p) { return p.x >= selection.start && p.x <= selection.end; };
+    markClipsDirty(u32(std::find_if(clips.begin(), clips.end(), inSelection) - clips.begin()), u32(clips.size()));
+    markPathsDirty(u32(std::find_if(paths.begin(), paths.end(), inSelection) - paths.begin()), u32(paths.size()));
+
+    std::erase_if(clips, [this] (const Clip& c) { return c.x >= selection.start && c.x <= selection.end; }); 
+    std::erase_if(paths, [this] (const Path& p) { return p.x >= selection.start && p.x <= selection.end; }); 
+  }
+
+  updateTrack();
+}
+
+void StateManager::setPlayheadPosition(f32 x) {
+  JUCE_ASSERT_MESSAGE_THREAD
+  assert(instance);
+  assert(x >= 0);
+  assert(editMode);
+
+  if (neqf32(playheadPosition, x)) {
+    playheadPosition = x;
+
+    if (trackView) {
+      trackView->playhead.x = playheadPosition * zoom;
+      trackView->repaint();
+    }
+
+    if (!clips.empty()) {
+      engine->interpolate();
+    }
+  }
+
+  selectClip(NONE);
+}
+
+void StateManager::setPlayheadPositionDenorm(f32 x) {
+  setPlayheadPosition(grid.snap(x) / zoom);
+}
+
+bool StateManager::shouldProcessParameter(u32 index) {
+  if (parameters[index].active && parameters[index].parameter->isAutomatable()) {
+    return parameters[index].parameter->isDiscrete() ? discreteMode.load() : true; 
+  }
+
+  return false;
+}
+
+void StateManager::movePlayheadForward() {
+  if (editMode) {
+    f32 pos = playheadPosition * zoom;
+
+    if (grid.snapOn) {
+      pos += grid.snapInterval;  
+    } else {
+      pos += 1;
+    }
+
+    setPlayheadPositionDenorm(pos);
+  }
+}
+
+void StateManager::movePlayheadBack() {
+  if (editMode) {
+    f32 pos = playheadPosition * zoom;
+
+    if (grid.snapOn) {
+      pos -= grid.snapInterval;  
+    } else {
+      pos -= 1;
+    }
+    
+    if (pos >= 0) {
+      setPlayheadPositionDenorm(pos);
+    }
+  }
+}
+
+void StateManager::randomiseParameters() {
+  JUCE_ASSERT_MESSAGE_THREAD
+
+  for (u32 i = 0; i < parameters.size(); ++i) {
+    if (shouldProcessParameter(i)) {
+      parameters[i].parameter->setValueNotifyingHost(random(randomSpread));
+    }
+  }
+}
+
+// NOTE(luca): count new clips scattered around the selected one and appended after the last clip,
+// alternating lanes so that consecutive variations morph into each other. Parameters that aren't
+// processed stay locked to the source value. Nothing goes through the hosted plug-in.
+void StateManager::generateVariations(u32 count) {
+  JUCE_ASSERT_MESSAGE_THREAD
+  commitDragPreview();
+  assert(instance);
+
+  if (selectedClipID == NONE || count == 0) {
+    return;
+  }
+
+  u32 numParameters = u32(parameters.size());
+  std::vector<f32> centre(numParameters);
+  clips[u32(selectedClipID)].expand(centre.data());
+
+  std::vector<f32> depth(numParameters);
+
+  for (u32 i = 0; i < numParameters; ++i) {
+    depth[i] = shouldProcessParameter(i) ? kVariationDepth : 0.f;
+  }
+
+  std::vector<f32> batch(size_t(count) * numParameters);
+  u64 seed = u64(juce::Random::getSystemRandom().nextInt64());
+  f32 spread = randomSpread;
+
+  for (u32 v = 0; v < count; ++v) {
+    f32* row = batch.data() + size_t(v) * numParameters;
+    u64 counter = u64(v) * numParameters;
+
+    for (u32 i = 0; i < numParameters; ++i) {
+      f32 n = std::clamp(counterNormal(seed, counter + i) / spread, -1.f, 1.f);
+      row[i] = std::clamp(centre[i] + n * depth[i], 0.f, 1.f);
+    }
+  }
+
+  f32 x = 0;
+
+  for (const auto& c : clips) {
+    x = std::max(x, c.x);
+  }
+
+  f32 spacing = f32(grid.ts.numerator);
+  f32 y = clips[u32(selectedClipID)].y;
+
+  {
+    ScopedProcLock lk(proc);
+
+    u32 first = u32(clips.size());
+    clips.reserve(clips.size() + count);
+
+    for (u32 v = 0; v < count; ++v) {
+      clips.emplace_back();
+      auto& clip = clips.back();
+
+      y = 1 - y;
+      clip.x = x + spacing * f32(v + 1);
+      clip.y = y;
+      clip.c = 0.5f;
+      captureClip(clip, batch.data() + size_t(v) * numParameters);
+    }
+
+    markClipsDirty(first, u32(clips.size()));
+    selectClip(NONE);
+    updateTrack();
+  }
+
+  if (editMode) {
+    engine->interpolate();
+  }
+}
+
+void StateManager::captureClip(Clip& clip, const f32* values) {
+  if (!baseSnapshot) {
+    baseSnapshot = std::make_shared<const std::vector<f32>>(values, values + parameters.size());
+  }
+
+  clip.setParameters(baseSnapshot, values, quantizedParameters);
+}
+
+void StateManager::updateQuantizedParameters() {
+  quantizedParameters.resize(parameters.size());
+
+  for (u32 i = 0; i < parameters.size(); ++i) {
+    auto* p = parameters[i].parameter;
+    bool stepped = p->isDiscrete() || p->isBoolean() || p->getNumSteps() != juce::AudioProcessor::getDefaultNumParameterSteps();
+    quantizedParameters[i] = quantizeClips && !stepped && i <= Clip::maxQuantizedIndex;
+  }
+}
+
+void StateManager::setAllParametersActive(bool v) {
+  JUCE_ASSERT_MESSAGE_THREAD
+
+  {
+    ScopedProcLock lk(proc);
+
+    for (u32 i = 0; i < parameters.size(); ++i) {
+      setParameterActive(i, v);
+    }
+  }
+}
+
+void StateManager::setParameterActive(u32 index, bool a) {
+  JUCE_ASSERT_MESSAGE_THREAD
+
+  {
+    ScopedProcLock lk(proc);
+    parameters[index].active = a;
+    history.dirtyActive = true;
+    ++stateGeneration;
+  }
+
+  if (parametersView) {
+    parametersView->active[index] = a;
+    parametersView->repaintParameter(index);
+  }
+}
+
+void StateManager::setParameterCurve(u32 index, Curve curve) {
+  JUCE_ASSERT_MESSAGE_THREAD
+  assert(index < parameters.size());
+
+  {
+    ScopedProcLock lk(proc);
+    parameters[index].curve = curve;
+    ++stateGeneration;
+    updateCurveGroups();
+    lerpPairsSync.inSync = false;
+
+    if (clips.size() > 1) {
+      updateLerpPairs();
+    }
+    engine->lastVisitedPair = UNDEFINED_PAIR;
+  }
+
+  if (parametersView) {
+    parametersView->curves[index] = u8(curve);
+    parametersView->repaintParameter(index);
+  }
+
+  if (editMode && !clips.empty()) {
+    engine->interpolate();
+  }
+}
+
+void StateManager::cycleLastTouchedParameterCurve() {
+  JUCE_ASSERT_MESSAGE_THREAD
+
+  i32 index = lastTouchedParameter;
+
+  if (index == NONE || u32(index) >= parameters.size()) {
+    return;
+  }
+
+  auto curve = Curve((u32(parameters[u32(index)].curve) + 1) % kNumCurves);
+  setParameterCurve(u32(index), curve);
+
+  static constexpr const char* names[] = { "linear", "exponential", "s-curve", "step" };
+  Logger::info(parameters[u32(index)].parameter->getName(1024) + " now uses the " + names[u32(curve)] + " curve");
+}
+
+void StateManager::updateCurveGroups() {
+  for (auto& group : engine->curveGroups) {
+    group.clear();
+  }
+
+  for (u32 i = 0; i < parameters.size(); ++i) {
+    engine->curveGroups[u32(parameters[i].curve)].push_back(i);
+  }
+}
+
+void StateManager::parameterValueChanged(i32 i, f32 value) {
+  if (engine->isEcho(u32(i), value)) {
+    return;
+  }
+
+  pendingParameterChanges.set(u32(i));
+  triggerAsyncUpdate();
+}
+
+void StateManager::handleAsyncUpdate() {
+  JUCE_ASSERT_MESSAGE_THREAD
+
+  if (!instance) {
+    return;
+  }
+
+  bool capture = captureParameterChanges;
+  bool release = releaseParameterChanges;
+  bool changed = false;
+  bool activeChanged = false;
+  bool selectedChanged = false;
+  bool enterEditMode = false;
+
+  {
+    ScopedProcLock lk(proc);
+
+    pendingParameterChanges.drain([&] (u32 i) {
+      if (i >= parameters.size()) {
+        return;
+      }
+
+      changed = true;
+      f32 value = parameters[i].parameter->getValue();
+
+      if (parametersView) {
+        parametersView->setValue(i, value);
+      }
+
+      if ((capture || release) && parameters[i].active != capture) {
+        parameters[i].active = capture;
+        activeChanged = true;
+
+        if (parametersView) {
+          parametersView->active[i] = capture;
+          parametersView->repaintParameter(i);
+        }
+      }
+
+      // NOTE(luca): moves of the parameter being recorded end up on the lane, not in a clip
+      if (i32(i) == recordParameter) {
+        return;
+      }
+
+      if (shouldProcessParameter(i)) {
+        if (!editMode) {
+          enterEditMode = true;
+        } else if (selectedClipID != NONE) {
+          clips[u32(selectedClipID)].setParameter(i, value, quantizedParameters[i]);
+          selectedChanged = true;
+        }
+      }
+    });
+
+    if (!changed) {
+      return;
+    }
+
+    engine->lastVisitedPair = UNDEFINED_PAIR;
+
+    if (activeChanged) {
+      history.dirtyActive = true;
+      ++stateGeneration;
+    }
+
+    if (selectedChanged) {
+      markClipsDirty(u32(selectedClipID), u32(selectedClipID) + 1);
+      markLerpPairsDirty(u32(selectedClipID));
+      ++clipGeneration;
+
+      if (padMode) {
+        engine->updatePadRow(u32(selectedClipID));
+      }
+
+      if (clips.size() > 1) {
+        updateLerpPairs();
+      }
+    }
+  }
+
+  if (enterEditMode) {
+    setEditMode(true);
+  }
+}
+
+void StateManager::audioProcessorParameterChanged(juce::AudioProcessor*, i32, f32) {
+  ++stateGeneration;
+}
+
+void StateManager::audioProcessorChanged(juce::AudioProcessor*, const ChangeDetails&) {
+  // NOTE(luca): presets and other state that isn't exposed through parameters
+  ++stateGeneration;
+}
+
+void StateManager::parameterGestureChanged(i32 i, bool starting) {
+  if (starting) {
+    lastTouchedParameter = i;
+
+    if (recordMode && !editMode && !padMode && recordParameter == NONE) {
+      recordParameter = i;
+    }
+  }
+
+  // NOTE(luca): edits to the selected clip made during one gesture become a single undo step
+  if (!starting) {
+    juce::WeakReference<StateManager> weak(this);
+
+    juce::MessageManager::callAsync([weak, i] {
+      if (weak != nullptr) {
+        weak->handleUpdateNowIfNeeded();
+
+        if (weak->recordParameter == i) {
+          weak->finishRecording();
+        }
+
+        weak->commitUndoStep();
+      }
+    });
+  }
+}
+
+void StateManager::updateLerpPairs() {
+
+  ScopedProcLock lk(proc);
+
+  assert(engine);
+  assert(clips.size() > 1);
+
+  // NOTE(luca): the points are previewing a drag and don't match the clips yet, the commit catches up
+  if (dragPreview.dirty) {
+    return;
+  }
+
+  auto& pairs = engine->lerpPairs;
+  auto& sync = lerpPairsSync;
+  u32 numClips = u32(clips.size());
+
+  sync.pairOf.assign(numClips, NONE);
+
+  if (sync.inSync) {
+    for (u32 i = 0; i < pairs.size(); ++i) {
+      if (pairs[i].a < numClips) {
+        sync.pairOf[pairs[i].a] = i32(i);
+      }
+    }
+  }
+
+  auto isDirty = [&] (u32 id) { return id < sync.dirty.size() && sync.dirty[id]; };
+
+  sync.next.resize(numClips - 1);
+
+  std::vector<u32> differences;
+  u32 n = 0;
+  i32 previous = NONE;
+
+  for (const auto& point : points) {
+    if (!point.isClip) {
+      continue;
+    }
+
+    if (previous != NONE) {
+      auto& pair = sync.next[n++];
+      pair.a = u32(previous);
+      pair.b = point.id;
+      pair.start = clips[pair.a].x;
+      pair.end = clips[pair.b].x;
+
+      i32 old = sync.pairOf[pair.a];
+
+      if (old != NONE && pairs[u32(old)].b == pair.b && !isDirty(pair.a) && !isDirty(pair.b)) {
+        pair.interpolate = pairs[u32(old)].interpolate;
+        pair.changed = std::move(pairs[u32(old)].changed);
+      } else {
+        for (auto& c : pair.changed) {
+          c.clear();
+        }
+
+        if (i32(clips[pair.a].y) != i32(clips[pair.b].y)) {
+          pair.interpolate = Clip::findDifferences(clips[pair.a], clips[pair.b], differences);
+
+          for (u32 p : differences) {
+            pair.changed[u32(parameters[p].curve)].push_back(p);
+          }
+        } else {
+          pair.interpolate = false;
+        }
+      }
+    }
+
+    previous = i32(point.id);
+  }
+
+  assert(n == numClips - 1);
+
+  pairs.swap(sync.next);
+  sync.dirty.clear();
+  sync.inSync = true;
+}
+
+void StateManager::markLerpPairsDirty(u32 id) {
+  auto& dirty = lerpPairsSync.dirty;
+
+  if (dirty.size() <= id) {
+    dirty.resize(id + 1, false);
+  }
+
+  dirty[id] = true;
+}
+
+void StateManager::updateAutomation() {
+  // NOTE(luca): edits that kept the points sorted themselves skip the rebuild, everything else
+  // (undo, restore, batch edits) starts over
+  if (!std::exchange(pointsInSync, false)) {
+    rebuildPoints();
+  }
+
+  buildAutomationPath(automation);
+}
 
-  if (juce::MessageManager::existsAndIsLockedByCurrentThread() || juce::MessageManager::existsAndIsCurrentThread()) {
-    sendParameterUpdate();
-  } else {
-    juce::MessageManager::callAsync([sendParameterUpdate] { sendParameterUpdate(); });
+// NOTE(luca): points at the same x are ordered clips first and then by id, incremental edits and a full
+// rebuild have to agree or the lerp pairs would depend on the edit history
+static bool comparePoints(const AutomationPoint& a, const AutomationPoint& b) {
+  if (a.x < b.x) {
+    return true;
+  } else if (b.x < a.x) {
+    return false;
+  } else if (a.isClip != b.isClip) {
+    return a.isClip;
   }
+
+  return a.id < b.id;
 }
 
-void StateManager::parameterGestureChanged(i32, bool) {}
+void StateManager::rebuildPoints() {
+  points.resize(clips.size() + paths.size());
 
-void StateManager::updateLerpPairs() {
+  u32 n = 0;
+  for (; n < clips.size(); ++n) {
+    points[n] = { clips[n].x, clips[n].y, clips[n].c, n, true };
+  }
+  for (u32 i = 0; i < paths.size(); ++i) {
+    points[i + n] = { paths[i].x, paths[i].y, paths[i].c, i, false };
+  }
 
-  ScopedProcLock lk(proc);
+  std::sort(points.begin(), points.end(), comparePoints);
 
-  assert(engine);
-  assert(clips.size() > 1);
-  
-  auto& pairs = engine->lerpPairs;
+  clipPoints.resize(clips.size());
+  pathPoints.resize(paths.size());
+  reindexPoints(0, u32(points.size()));
+  lerpPairsSync.inSync = false;
+}
 
-  pairs.resize(clips.size()); 
-  
-  for (u32 i = 0; i < clips.size(); ++i) {
-    pairs[i].start = clips[i].x;
-    pairs[i].a = i;
-  }
+// NOTE(luca): the element was just appended to clips or paths
+void StateManager::insertPoint(bool isClip, u32 id) {
+  auto& refs = isClip ? clipPoints : pathPoints;
+  assert(id == refs.size());
+  assert(points.size() + 1 == clips.size() + paths.size());
 
-  std::sort(pairs.begin(), pairs.end(), [] (LerpPair& a, LerpPair& b) { return a.start < b.start; });
+  AutomationPoint point { 0, 0, 0.5f, id, isClip };
 
-  u32 numParameters = u32(clips[0].parameters.size());
+  if (isClip) {
+    point.x = clips[id].x; point.y = clips[id].y; point.c = clips[id].c;
+  } else {
+    point.x = paths[id].x; point.y = paths[id].y; point.c = paths[id].c;
+  }
 
-  for (u32 i = 1; i < clips.size(); ++i) {
-    pairs[i - 1].end = pairs[i].start;
-    pairs[i - 1].b = pairs[i].a;
+  auto it = std::upper_bound(points.begin(), points.end(), point, comparePoints);
+  u32 at = u32(it - points.begin());
 
-    u32 a = pairs[i - 1].a;
-    u32 b = pairs[i - 1].b;
+  points.insert(it, point);
+  refs.push_back(at);
+  reindexPoints(at, u32(points.size()));
+  pointsInSync = true;
+}
 
-    if (i32(clips[a].y) != i32(clips[b].y)) {
-      pairs[i - 1].interpolate = true;
-      pairs[i - 1].parameters.resize(numParameters);
+// NOTE(luca): the element was just erased from clips or paths, everything after it moved down by one
+void StateManager::erasePoint(bool isClip, u32 id) {
+  auto& refs = isClip ? clipPoints : pathPoints;
+  assert(id < refs.size());
+  assert(points.size() == clips.size() + paths.size() + 1);
 
-      for (u32 parameterIndex = 0; parameterIndex < numParameters; ++parameterIndex) {
-        pairs[i - 1].parameters[parameterIndex] = neqf32(clips[a].parameters[parameterIndex], clips[b].parameters[parameterIndex]);
-      }
+  u32 at = refs[id];
+  points.erase(points.begin() + at);
+  refs.erase(refs.begin() + id);
 
-      bool foundInterpolation = false;
+  for (auto& p : points) {
+    if (p.isClip == isClip && p.id > id) {
+      --p.id;
+    }
+  }
 
-      for (u32 parameterIndex = 0; parameterIndex < numParameters; ++parameterIndex) {
-        if (pairs[i - 1].parameters[parameterIndex]) {
-          foundInterpolation = true;
-          break;
-        }
+  // NOTE(luca): pairs with the erased clip can't be carried over, the others follow the ids
+  if (isClip) {
+    for (auto& pair : engine->lerpPairs) {
+      if (pair.a == id || pair.b == id) {
+        pair.a = pair.b = u32(NONE);
+      } else {
+        pair.a -= pair.a > id;
+        pair.b -= pair.b > id;
       }
+    }
 
-      if (!foundInterpolation) {
-        pairs[i - 1].interpolate = false; 
-      }
-    } else {
-      pairs[i - 1].interpolate = false;
+    if (id < lerpPairsSync.dirty.size()) {
+      lerpPairsSync.dirty.erase(lerpPairsSync.dirty.begin() + id);
     }
   }
 
-  pairs.pop_back();
+  reindexPoints(at, u32(points.size()));
+  pointsInSync = true;
 }
 
-void StateManager::updateAutomation() {
-  automation.clear();
-  points.resize(clips.size() + paths.size());
+void StateManager::updatePoint(bool isClip, u32 id) {
+  auto* point = isClip ? findClipPoint(id) : findPathPoint(id);
 
-  u32 n = 0;
-  for (; n < clips.size(); ++n) {
-    points[n].x = clips[n].x; 
-    points[n].y = clips[n].y; 
-    points[n].c = clips[n].c; 
-    points[n].id = n;
-    points[n].clip = &clips[n];
-    points[n].path = nullptr;
+  if (isClip) {
+    point->x = clips[id].x; point->y = clips[id].y; point->c = clips[id].c;
+    markLerpPairsDirty(id);
+  } else {
+    point->x = paths[id].x; point->y = paths[id].y; point->c = paths[id].c;
   }
-  for (u32 i = 0; i < paths.size(); ++i) {
-    points[i + n].x = paths[i].x; 
-    points[i + n].y = paths[i].y; 
-    points[i + n].c = paths[i].c; 
-    points[i + n].id = i; 
-    points[i + n].clip = nullptr;
-    points[i + n].path = &paths[i];
+
+  sortPoint(u32(point - points.data()));
+  pointsInSync = true;
+}
+
+// NOTE(luca): moves a single point whose x changed back into order, only the range it crossed is reindexed
+void StateManager::sortPoint(u32 at) {
+  assert(at < points.size());
+
+  auto begin = points.begin();
+  auto point = points[at];
+
+  if (at > 0 && comparePoints(point, points[at - 1])) {
+    u32 to = u32(std::upper_bound(begin, begin + at, point, comparePoints) - begin);
+    std::rotate(begin + to, begin + at, begin + at + 1);
+    reindexPoints(to, at + 1);
+  } else if (at + 1 < points.size() && comparePoints(points[at + 1], point)) {
+    u32 to = u32(std::upper_bound(begin + at + 1, points.end(), point, comparePoints) - begin);
+    std::rotate(begin + at, begin + at + 1, begin + to);
+    reindexPoints(at, to);
   }
+}
+
+void StateManager::reindexPoints(u32 begin, u32 end) {
+  for (u32 i = begin; i < end; ++i) {
+    (points[i].isClip ? clipPoints : pathPoints)[points[i].id] = i;
+  }
+}
 
-  std::sort(points.begin(), points.end(), [] (const AutomationPoint& a, const AutomationPoint& b) { return a.x < b.x; });
+void StateManager::buildAutomationPath(juce::Path& path) {
+  path.clear();
 
   if (points.size() > 0) {
-    automation.startNewSubPath(0, points[0].y);
+    path.startNewSubPath(0, points[0].y);
   }
 
   for (auto& p2 : points) {
-    auto p1 = automation.getCurrentPosition();
+    auto p1 = path.getCurrentPosition();
     f32 cx = p1.x + (p2.x - p1.x) * (p1.y < p2.y ? p2.c : 1.f - p2.c); 
     f32 cy = (p1.y < p2.y ? p1.y : p2.y) + std::abs(p2.y - p1.y) * (1.f - p2.c);
-    automation.quadraticTo(cx, cy, p2.x, p2.y);
+    path.quadraticTo(cx, cy, p2.x, p2.y);
   }
 }
 
-void StateManager::updateAutomationView() {
+void StateManager::updateAutomationViewPath(const juce::Path& path) {
   assert(automationView);
 
-  automationView->selection.start = selection.start * zoom;
-  automationView->selection.end = selection.end * zoom;
-  automationView->automation = automation; 
+  automationView->automation = path; 
 
   automationView->automation.applyTransform(juce::AffineTransform::scale(zoom, kAutomationLaneHeight - Style::lineThickness));
   automationView->automation.applyTransform(juce::AffineTransform::translation(0, Style::lineThickness / 2));
 
   auto p = automationView->automation.getCurrentPosition();
   automationView->automation.quadraticTo(trackWidth, p.y, trackWidth, p.y);
+}
+
+void StateManager::updateAutomationView() {
+  assert(automationView);
+
+  automationView->selection.start = selection.start * zoom;
+  automationView->selection.end = selection.end * zoom;
+
+  updateAutomationViewPath(automation);
 
   {
     auto& pathViews = automationView->pathViews;
@@ -675,8 +1707,12 @@ void StateManager::updateAutomationView() {
       u32 diff = numPaths - numViews;
 
       while (diff--) {
-        pathViews.add(new PathView());
-        automationView->addAndMakeVisible(pathViews.getLast());
+        auto* view = pathViews.add(new PathView());
+        view->move = [this] (u32 id, f32 x, f32 y) { movePathDenorm(id, x, y, paths[id].c); };
+        view->remove = [this] (u32 id) { removePath(id); };
+        view->beginGesture = [this] { beginDragPreview(); };
+        view->endGesture = [this] { endDragPreview(); };
+        automationView->addAndMakeVisible(view);
       }
     } else if (numViews > numPaths) {
       i32 diff = i32(numViews - numPaths);
@@ -687,20 +1723,56 @@ void StateManager::updateAutomationView() {
       const auto& path = paths[i];
       auto* view = pathViews[i32(i)];
      
-      view->id     = i;
-      view->move   = [&path, this] (u32 id, f32 x, f32 y) { movePathDenorm(id, x, y, path.c); };
-      view->remove = [this] (u32 id) { removePath(id); };
+      view->id = i;
+      setPathViewBounds(view, path.x, path.y);
+    }
+  }
+
+  automationView->repaint();
+}
 
-      i32 x = i32(path.x * zoom - PathView::posOffset);
-      i32 y = i32(path.y * automationView->getHeight() - PathView::posOffset);
-         
-      view->setBounds(x, y, PathView::size, PathView::size);
+void StateManager::updateDragPreviewView() {
+  if (!instanceEditor) {
+    return;
+  }
+
+  assert(trackView && automationView);
+
+  juce::Path preview;
+  buildAutomationPath(preview);
+  updateAutomationViewPath(preview);
+
+  for (const auto& point : points) {
+    if (point.isClip) {
+      setClipViewBounds(trackView->clipViews[i32(point.id)], point.x, point.y);
+    } else {
+      setPathViewBounds(automationView->pathViews[i32(point.id)], point.x, point.y);
     }
   }
 
   automationView->repaint();
 }
 
+void StateManager::setClipViewBounds(ClipView* view, f32 x, f32 y) {
+  assert(view && trackView);
+
+  i32 h = kPresetLaneHeight;
+  i32 w = kPresetLaneHeight;
+  i32 viewX = i32((x * zoom) - w * 0.5f);
+  i32 viewY = !bool(y) ? trackView->b.presetLaneTop.getY() : trackView->b.presetLaneBottom.getY();
+
+  view->setBounds(viewX, viewY, w, h);
+}
+
+void StateManager::setPathViewBounds(PathView* view, f32 x, f32 y) {
+  assert(view && automationView);
+
+  i32 viewX = i32(x * zoom - PathView::posOffset);
+  i32 viewY = i32(y * automationView->getHeight() - PathView::posOffset);
+
+  view->setBounds(viewX, viewY, PathView::size, PathView::size);
+}
+
 void StateManager::updateTrackView() {
   assert(trackView);
 
@@ -712,9 +1784,15 @@ void StateManager::updateTrackView() {
   if (numViews < numClips) {
     u32 diff = numClips - numViews;
 
+    // NOTE(luca): callbacks take the id at call time so views are bound once, edits only renumber them
     while (diff--) {
-      clipViews.add(new ClipView());
-      trackView->addAndMakeVisible(clipViews.getLast());
+      auto* view = clipViews.add(new ClipView());
+      view->move = [this] (u32 id, f32 x, f32 y) { moveClipDenorm(id, x, y, clips[id].c); };
+      view->remove = [this] (u32 id) { removeClip(id); };
+      view->select = [this] (i32 id) { selectClip(id); };
+      view->beginGesture = [this] { beginDragPreview(); };
+      view->endGesture = [this] { endDragPreview(); };
+      trackView->addAndMakeVisible(view);
     }
   } else if (numViews > numClips) {
     i32 diff = i32(numViews - numClips);
@@ -728,16 +1806,7 @@ void StateManager::updateTrackView() {
     view->id = i;
     view->selected = selectedClipID == i32(i);
 
-    view->move = [&clip, this] (u32 id, f32 x, f32 y) { moveClipDenorm(id, x, y, clip.c); };
-    view->remove = [this] (u32 id) { removeClip(id); };
-    view->select = [this] (i32 id) { selectClip(id); };
-
-    i32 h = kPresetLaneHeight;
-    i32 w = kPresetLaneHeight;
-    i32 x = i32((clip.x * zoom) - w * 0.5f);
-    i32 y = !bool(clip.y) ? trackView->b.presetLaneTop.getY() : trackView->b.presetLaneBottom.getY();
-
-    view->setBounds(x, y, w, h);
+    setClipViewBounds(view, clip.x, clip.y);
   }
 
   trackView->setSize(trackWidth, kTrackHeight);
@@ -758,6 +1827,12 @@ void StateManager::updateGrid() {
 void StateManager::updateTrack() {
   assert(instance);
 
+  if (padMode) {
+    layoutPadPoints();
+    engine->buildPadMatrix();
+  }
+
+  ++clipGeneration;
   updateAutomation(); 
 
   if (instanceEditor) {
@@ -767,10 +1842,18 @@ void StateManager::updateTrack() {
     updateGrid();
     updateTrackView();
     updateAutomationView();
+    updatePadView();
+    updateInfoView();
   }
 
   if (clips.size() > 1) {
     updateLerpPairs();
+  } else {
+    lerpPairsSync = {};
+  }
+
+  if (!dragPreview.active) {
+    commitUndoStep();
   }
 }
 
@@ -781,6 +1864,22 @@ void StateManager::updateToolBarView() {
   toolBarView->repaint();
 }
 
+void StateManager::updateInfoView() {
+  assert(editor);
+
+  size_t sparse = baseSnapshot ? baseSnapshot->capacity() * sizeof(f32) : 0;
+  size_t dense = 0;
+
+  for (const auto& c : clips) {
+    sparse += c.getMemoryUsage();
+    dense += sizeof(Clip) + c.getNumParameters() * sizeof(f32);
+  }
+
+  editor->mainView.infoView.memoryUsage = "Clip snapshots " + juce::File::descriptionOfSizeInBytes(i64(sparse))
+                                        + " (" + juce::File::descriptionOfSizeInBytes(i64(dense)) + " dense)";
+  editor->mainView.infoView.repaint();
+}
+
 void StateManager::updateTrackWidth() {
   f32 width = 0;
 
@@ -817,6 +1916,13 @@ void StateManager::showDefaultView() {
   stopTimer();
   editor->mainView.setVisible(false);
   editor->defaultView.setVisible(true);
+
+  if (std::exchange(pluginIndexDirty, false)) {
+    editor->defaultView.updateIndex();
+  }
+
+  editor->defaultView.setLoading(loadingPluginName);
+  editor->defaultView.setRecoverable(!Journal::findOrphans().empty());
   editor->setSize(kDefaultViewWidth, kDefaultViewHeight);
 }
 
@@ -850,6 +1956,9 @@ void StateManager::showMainView() {
       }
     };
 
+    automationView->beginGesture = [this] { beginDragPreview(); };
+    automationView->endGesture = [this] { endDragPreview(); };
+
     automationView->addPath = [this] (f32 x, f32 y, f32 curve) { return addPathDenorm(x, y, curve); };
 
     automationView->bendAutomation = [this] (f32 x, f32 amount) {
@@ -873,34 +1982,23 @@ void StateManager::showMainView() {
     };
   }
 
-  //parametersView = &editor->mainView.parametersView;
-
-  //{
-  //  auto& views = parametersView->parameterViews;
-
-  //  u32 numParameters = u32(parameters.size());
-  //  views.clear();
-
-  //  for (u32 i = 0; i < numParameters; ++i) {
-  //    views.add(new ParametersView::ParameterView());
-  //    parametersView->addAndMakeVisible(views.getLast());
-
-  //    auto& parameter = parameters[i];
-  //    auto* view = views[i32(i)];
-  //    auto* ptr = &parameter;
-
-  //    view->dial.setValue(parameter.parameter->getValue(), DONT_NOTIFY);
-  //    view->dial.setDoubleClickReturnValue(true, parameter.parameter->getDefaultValue());
-  //    view->activeToggle.setToggleState(parameter.active, DONT_NOTIFY);
-  //    view->dial.active = parameter.active;
-  //    view->name = parameter.parameter->getName(1024);
+  {
+    parametersView = &editor->mainView.parametersView;
+    parametersView->toggleActive = [this] (u32 i) { setParameterActive(i, !parameters[i].active); };
+    parametersView->cycleCurve = [this] (u32 i) { setParameterCurve(i, Curve((u32(parameters[i].curve) + 1) % kNumCurves)); };
+    updateParametersView();
+  }
 
-  //    view->activeToggle.onClick = [this, i, ptr] { setParameterActive(i, !ptr->active); };
-  //    view->dial.onValueChange = [parameter, view] {
-  //      parameter.parameter->setValueNotifyingHost(f32(view->dial.getValue()));
-  //    };
-  //  }
-  //}
+  {
+    padView = &editor->mainView.pad;
+    padView->setPosition = [this] (f32 x, f32 y) { setPadPosition(x, y); };
+    padView->movePoint = [this] (u32 id, f32 x, f32 y) { movePadPoint(id, x, y); };
+    padView->beginGesture = [this] { beginPadGesture(); };
+    padView->endGesture = [this] { endPadGesture(); };
+    padView->beginPointGesture = [this] { beginDragPreview(); };
+    padView->endPointGesture = [this] { endDragPreview(); };
+    editor->mainView.setPadMode(padMode);
+  }
 
   {
     toolBarView = &editor->mainView.toolBar;
@@ -914,19 +2012,20 @@ void StateManager::showMainView() {
   updateTrack();
   updateToolBarView();
 
-  startTimerHz(60);
+  transportChanged = true;
+  idleFrames = 0;
+  startTimerHz(kFrameRate);
 }
 
-bool StateManager::loadPlugin(const juce::String& id) {
+void StateManager::loadPlugin(const juce::String& id, std::unique_ptr<Session> state) {
   JUCE_ASSERT_MESSAGE_THREAD
 
-  bool result = false;
-
   {
     ScopedProcLock lk(proc);
 
     { // NOTE(luca): clear everything
       trackView = nullptr;
+      padView = nullptr;
       automationView = nullptr;
       parametersView = nullptr;
       toolBarView = nullptr;
@@ -936,6 +2035,8 @@ bool StateManager::loadPlugin(const juce::String& id) {
       zoom = 100;
       discreteMode = false;
       discreteMode = false;
+      quantizeClips = false;
+      padMode = false;
       captureParameterChanges = false;
       releaseParameterChanges = false;
 
@@ -947,11 +2048,28 @@ bool StateManager::loadPlugin(const juce::String& id) {
       automation = {};
       selection = {};
       selectedClipID = NONE;
+      dragPreview = {};
+      history = {};
+      journal.stop();
+      stateCache = {};
+      ++stateGeneration;
 
       paths.clear();
       clips.clear();
+      baseSnapshot.reset();
       parameters.clear();
+      quantizedParameters.clear();
       points.clear();
+      clipPoints.clear();
+      pathPoints.clear();
+      pointsInSync = false;
+      lerpPairsSync = {};
+
+      // NOTE(luca): drops any load that is still in flight
+      ++loadGeneration;
+      loadingPluginName = "";
+      pendingState.reset();
+      recoveredJournal = juce::File();
 
       // TODO(luca): rethink this
       if (editor) {
@@ -964,53 +2082,141 @@ bool StateManager::loadPlugin(const juce::String& id) {
       instanceEditor.reset();
       instance.reset();
 
-      if (editor) {
-        showDefaultView();
-      }
+      cancelPendingUpdate();
+      pendingParameterChanges = {};
+      recordMode = false;
+      recordParameter = NONE;
+      recorder.finish();
 
       paths.reserve(1024);
       clips.reserve(1024);
       parameters.reserve(1024);
     }
+  }
 
-    {
-      pluginID = id;
-      juce::String errorMessage;
-
-      if (id != "") {
-        auto description = plugin->knownPluginList.getTypeForIdentifierString(id);
-
-        if (description) {
-          instance = plugin->apfm.createPluginInstance(*description, proc.getSampleRate(), proc.getBlockSize(), errorMessage);
-
-          if (instance) {
-            auto processorParameters = instance->getParameters();
-            u32 numParameters = u32(processorParameters.size());
-            parameters.reserve(numParameters);
-            uiParameterSync.values.resize(numParameters);
-            uiParameterSync.updates.resize(numParameters);
-
-            for (u32 i = 0; i < numParameters; ++i) {
-              parameters.emplace_back();
-              parameters.back().parameter = processorParameters[i32(i)];
-              parameters.back().parameter->addListener(this);
-            }
-
-            engine->instance = instance.get();
-            proc.prepareToPlay(proc.getSampleRate(), proc.getBlockSize());
-
-            if (editor) {
-              showMainView();
-            }
-            
-            result = true;
-          }
-        }
+  std::unique_ptr<juce::PluginDescription> description;
+
+  if (id != "") {
+    description = plugin->library->getKnownPluginList().getTypeForIdentifierString(id);
+  }
+
+  if (description) {
+    pluginID = id;
+    pendingState = std::move(state);
+    loadingPluginName = description->name;
+  }
+
+  if (editor) {
+    showDefaultView();
+  }
+
+  if (!description) {
+    return;
+  }
+
+  u32 generation = loadGeneration;
+  f64 sampleRate = proc.getSampleRate();
+  i32 blockSize = proc.getBlockSize();
+  juce::WeakReference<StateManager> weak(this);
+
+  auto onCreated = [weak, generation, sampleRate, blockSize] (std::unique_ptr<juce::AudioPluginInstance> p, const juce::String& error) {
+    if (weak == nullptr || weak->loadGeneration != generation) {
+      return;
+    }
+
+    if (!p) {
+      Logger::error("Failed to create plug-in instance: " + error);
+      weak->loadPlugin({});
+      return;
+    }
+
+    // NOTE(luca): instantiation has to happen wherever the format wants it, prepareToPlay can be
+    // moved off the message thread
+    auto holder = std::make_shared<std::unique_ptr<juce::AudioPluginInstance>>(std::move(p));
+
+    weak->loader.addJob([weak, holder, generation, sampleRate, blockSize] {
+      if (sampleRate > 0 && blockSize > 0) {
+        (*holder)->prepareToPlay(sampleRate, blockSize);
       }
+
+      juce::MessageManager::callAsync([weak, holder, generation, sampleRate, blockSize] {
+        if (weak != nullptr && weak->loadGeneration == generation) {
+          weak->installPlugin(std::move(*holder), sampleRate, blockSize);
+        }
+      });
+    });
+  };
+
+  plugin->library->getFormatManager().createPluginInstanceAsync(*description, sampleRate, blockSize, onCreated);
+}
+
+void StateManager::installPlugin(std::unique_ptr<juce::AudioPluginInstance> p, f64 sampleRate, i32 blockSize) {
+  JUCE_ASSERT_MESSAGE_THREAD
+  assert(p && !instance);
+
+  instance = std::move(p);
+  loadingPluginName = "";
+
+  auto processorParameters = instance->getParameters();
+  u32 numParameters = u32(processorParameters.size());
+  parameters.reserve(numParameters);
+  uiParameterSync.values.resize(numParameters);
+  uiParameterSync.updates.resize(numParameters);
+  pendingParameterChanges.resize(numParameters);
+
+  for (u32 i = 0; i < numParameters; ++i) {
+    parameters.emplace_back();
+    parameters.back().parameter = processorParameters[i32(i)];
+  }
+
+  engine->prepareWrites(numParameters);
+  instance->addListener(this);
+
+  for (auto& p : parameters) {
+    p.parameter->addListener(this);
+  }
+
+  // NOTE(luca): the host may have changed the configuration while we were preparing in the background
+  if (proc.getSampleRate() > 0 && proc.getBlockSize() > 0) {
+    if (!juce::approximatelyEqual(proc.getSampleRate(), sampleRate) || proc.getBlockSize() != blockSize) {
+      instance->prepareToPlay(proc.getSampleRate(), proc.getBlockSize());
     }
   }
 
-  return result;
+  updateQuantizedParameters();
+  proc.setLatencySamples(instance->getLatencySamples());
+  engine->prepareBuffers(numParameters);
+  updateCurveGroups();
+
+  // NOTE(luca): until this point processBlock passes audio through untouched
+  engine->instance = instance.get();
+
+  if (pendingState) {
+    restore(*pendingState);
+    pendingState.reset();
+  }
+
+  if (recoveredJournal != juce::File()) {
+    recoveredJournal.deleteFile();
+    recoveredJournal = juce::File();
+  }
+
+  resetHistory();
+  journal.start(history.current);
+
+  if (editor) {
+    showMainView();
+  }
+}
+
+void StateManager::changeListenerCallback(juce::ChangeBroadcaster*) {
+  JUCE_ASSERT_MESSAGE_THREAD
+
+  if (editor && !instance) {
+    editor->defaultView.updateIndex();
+  } else {
+    pluginIndexDirty = true;
+  }
 }
 
 void StateManager::registerEditor(Editor* view) {
@@ -1018,6 +2224,7 @@ void StateManager::registerEditor(Editor* view) {
   assert(!editor);
 
   editor = view;
+  plugin->library->getKnownPluginList().addChangeListener(this);
 
   if (instance) {
     showMainView(); 
@@ -1031,149 +2238,334 @@ void StateManager::deregisterEditor(Editor* view) {
   assert(editor);
 
   stopTimer();
+  plugin->library->getKnownPluginList().removeChangeListener(this);
   editor = nullptr;
+  padView = nullptr;
+  parametersView = nullptr;
   instanceEditor.reset();
 }
 
 void StateManager::init() {
   plugin = static_cast<Plugin*>(&proc); 
   engine = &plugin->engine;
+  journal.captureMeta = [this] { return getJournalMeta(); };
+  journal.captureSettings = [this] { return getJournalSettings(); };
+  journal.captureGeneration = [this] { return u64(stateGeneration); };
+
+  proc.addParameter(padX = new juce::AudioParameterFloat(juce::ParameterID { "padX", 1 }, "Pad X", 0.f, 1.f, 0.5f));
+  proc.addParameter(padY = new juce::AudioParameterFloat(juce::ParameterID { "padY", 1 }, "Pad Y", 0.f, 1.f, 0.5f));
+
+  padXAttachment = std::make_unique<juce::ParameterAttachment>(*padX, [this] (f32) { padPositionChanged(); });
+  padYAttachment = std::make_unique<juce::ParameterAttachment>(*padY, [this] (f32) { padPositionChanged(); });
 }
 
-void StateManager::replace(const juce::ValueTree& tree) {
+void StateManager::replace(std::unique_ptr<Session> session) {
   JUCE_ASSERT_MESSAGE_THREAD
+  assert(session);
 
   juce::MessageManagerLock lk(juce::Thread::getCurrentThread());
 
   if (lk.lockWasGained()) {
-    if (!loadPlugin(tree["pluginID"])) {
-      return;
+    auto id = session->pluginID;
+    loadPlugin(id, std::move(session));
+  }
+}
+
+void StateManager::restore(const Session& session) {
+  JUCE_ASSERT_MESSAGE_THREAD
+  assert(instance);
+
+  instance->setStateInformation(session.pluginData.getData(), i32(session.pluginData.getSize()));
+  
+  setEditMode(session.editMode);
+  setDiscreteMode(session.discreteMode);
+  setPadMode(session.padMode);
+  *padX = session.padX;
+  *padY = session.padY;
+  quantizeClips = session.quantizeClips;
+  updateQuantizedParameters();
+
+  // NOTE(luca): maps every current parameter to its column in the saved matrix, NONE if the plug-in
+  // gained a parameter since the session was saved. A parameter keeps its saved position when the name
+  // there still matches, otherwise it takes the next unused saved column with its name so that repeated
+  // names ("", "Reserved", ...) map in order.
+  std::vector<i32> columns(parameters.size(), NONE);
+  bool identity = session.numParameters == parameters.size();
+
+  {
+    std::vector<juce::String> names(parameters.size());
+    std::vector<bool> used(session.numParameters, false);
+
+    for (u32 i = 0; i < parameters.size(); ++i) {
+      names[i] = parameters[i].parameter->getName(1024);
+
+      if (i < session.numParameters && names[i] == session.parameterNames[i32(i)]) {
+        columns[i] = i32(i);
+        used[i] = true;
+      }
     }
 
-    assert(instance);
+    struct SavedColumns {
+      std::vector<u32> indices;
+      u32 next = 0;
+    };
 
-    {
-      auto mb = tree["pluginData"].getBinaryData();
-      instance->setStateInformation(mb->getData(), i32(mb->getSize()));
+    std::unordered_map<juce::String, SavedColumns> savedIndex;
+    savedIndex.reserve(session.numParameters);
+
+    for (u32 i = 0; i < session.numParameters; ++i) {
+      if (!used[i]) {
+        savedIndex[session.parameterNames[i32(i)]].indices.push_back(i);
+      }
     }
-    
-    setEditMode(tree["editMode"]);
-    setDiscreteMode(tree["discreteMode"]);
-    
-    auto clipsTree = tree.getChild(0);
-    for (auto c : clipsTree) {
-      addClip(c["x"], c["y"], c["c"]);
-      auto& clip = clips.back();
-      clip.parameters.clear();
 
-      auto mb = c["parameters"].getBinaryData(); 
-      auto parameters_ = (f32*)mb->getData();
-      auto numParameters = mb->getSize() / sizeof(f32);
-      clip.parameters.reserve(numParameters); 
+    for (u32 i = 0; i < parameters.size(); ++i) {
+      if (columns[i] == NONE) {
+        if (auto it = savedIndex.find(names[i]); it != savedIndex.end() && it->second.next < it->second.indices.size()) {
+          columns[i] = i32(it->second.indices[it->second.next++]);
+        }
+      }
+
+      if (columns[i] != NONE) {
+        u32 saved = u32(columns[i]);
+        parameters[i].active = session.parameterActive[saved];
 
-      for (u32 i = 0; i < numParameters; ++i) {
-        clip.parameters.emplace_back(parameters_[i]); 
+        if (saved < session.parameterCurves.size() && session.parameterCurves[saved] < kNumCurves) {
+          parameters[i].curve = Curve(session.parameterCurves[saved]);
+        }
       }
 
-      assert(clip.parameters.size() == numParameters);
+      identity = identity && columns[i] == i32(i);
     }
+  }
+
+  {
+    ScopedProcLock lk(proc);
+    updateCurveGroups();
 
-    auto pathsTree = tree.getChild(1);
-    for (const auto& p : pathsTree) {
-      addPath(p["x"], p["y"], p["c"]);
+    clips.reserve(clips.size() + session.clips.size());
+    std::vector<f32> row(identity ? 0 : parameters.size());
+
+    // NOTE(luca): parameters the session doesn't know about keep their current value in every clip
+    for (u32 j = 0; j < row.size(); ++j) {
+      if (columns[j] == NONE) {
+        row[j] = parameters[j].parameter->getValue();
+      }
     }
 
-    {
-      auto parametersTree = tree.getChild(2);
+    for (u32 i = 0; i < session.clips.size(); ++i) {
+      const auto& c = session.clips[i];
+      auto saved = session.getClipParameters(i);
 
-      u32 i = 0;
-      for (auto v : parametersTree) {
-        juce::String name = v["name"];
+      clips.emplace_back();
+      auto& clip = clips.back();
+      clip.x = c.x;
+      clip.y = c.y;
+      clip.c = c.c;
 
-        if (name != parameters[i].parameter->getName(1024)) {
-          assert(false);
+      if (i < session.padPoints.size()) {
+        clip.padX = session.padPoints[i].x;
+        clip.padY = session.padPoints[i].y;
+      }
 
-          for (u32 j = 0; j < parameters.size(); ++j) {
-            if (name == parameters[j].parameter->getName(1024)) {
-              parameters[j].active = v["active"];
-              break; 
-            }
+      if (identity) {
+        captureClip(clip, saved);
+      } else {
+        for (u32 j = 0; j < parameters.size(); ++j) {
+          if (columns[j] != NONE) {
+            row[j] = saved[columns[j]];
           }
-        } else {
-          parameters[i].active = v["active"];
         }
 
-        ++i;
+        captureClip(clip, row.data());
       }
     }
 
-    if (clips.size() > 1) {
-      assert(engine);
-      updateLerpPairs();
+    paths.reserve(paths.size() + session.paths.size());
+
+    for (const auto& p : session.paths) {
+      paths.push_back({ p.x, p.y, p.c });
     }
 
+    selectedClipID = NONE;
     updateTrack(); 
   }
+
+  if (editMode && !clips.empty()) {
+    engine->interpolate();
+  }
 }
 
-juce::ValueTree StateManager::getState() {
+Session StateManager::getState() {
   JUCE_ASSERT_MESSAGE_THREAD
 
   juce::MessageManagerLock lk(juce::Thread::getCurrentThread());
 
   if (lk.lockWasGained()) {
-    juce::ValueTree tree("tree");
+    // NOTE(luca): the hosted plug-in is still loading so hand back what we were asked to restore
+    if (pendingState) {
+      return *pendingState;
+    }
 
-    juce::MemoryBlock mb;
+    Session session;
 
     if (instance) {
-      instance->getStateInformation(mb);
+      instance->getStateInformation(session.pluginData);
     }
 
-    tree.setProperty("zoom", zoom, nullptr)
-        .setProperty("editMode", editMode.load(), nullptr)
-        .setProperty("discreteMode", discreteMode.load(), nullptr)
-        .setProperty("pluginID", pluginID, nullptr)
-        .setProperty("pluginData", mb, nullptr);
+    session.pluginID = pluginID;
+    session.zoom = zoom;
+    session.editMode = editMode;
+    session.discreteMode = discreteMode;
+    session.quantizeClips = quantizeClips;
+    session.padMode = padMode;
+    session.padX = padX->get();
+    session.padY = padY->get();
+    session.numParameters = u32(parameters.size());
+
+    session.clips.reserve(clips.size());
+    session.clipParameters.resize(clips.size() * parameters.size());
+
+    session.padPoints.reserve(clips.size());
 
-    juce::ValueTree clipsTree("clips");
     for (const auto& c : clips) {
-      juce::ValueTree clip("clip");
-      clip.setProperty("x", c.x, nullptr)
-          .setProperty("y", c.y, nullptr)
-          .setProperty("c", c.c, nullptr)
-          .setProperty("parameters", { c.parameters.data(), c.parameters.size() * sizeof(f32) }, nullptr);
-      clipsTree.appendChild(clip, nullptr);
+      assert(c.getNumParameters() == parameters.size());
+      session.clips.push_back({ c.x, c.y, c.c });
+      session.padPoints.push_back({ c.padX, c.padY });
     }
 
-    juce::ValueTree pathsTree("paths");
+    expandClips(session.clipParameters.data());
+
+    session.paths.reserve(paths.size());
+
     for (const auto& p : paths) {
-      juce::ValueTree path("path");
-      path.setProperty("x", p.x, nullptr)
-          .setProperty("y", p.y, nullptr)
-          .setProperty("c", p.c, nullptr);
-      pathsTree.appendChild(path, nullptr);
+      session.paths.push_back({ p.x, p.y, p.c });
     }
 
-    juce::ValueTree parametersTree("parameters");
-    for (const auto& p : parameters) {
-      juce::ValueTree parameter("parameter");
-      parameter.setProperty("name", p.parameter->getName(1024), nullptr)
-               .setProperty("active", p.active, nullptr);
-      parametersTree.appendChild(parameter, nullptr);
-    }
+    session.parameterNames.ensureStorageAllocated(i32(parameters.size()));
+    session.parameterActive.reserve(parameters.size());
+    session.parameterQuantized.reserve(parameters.size());
+    session.parameterCurves.reserve(parameters.size());
 
-    tree.appendChild(clipsTree, nullptr);
-    tree.appendChild(pathsTree, nullptr);
-    tree.appendChild(parametersTree, nullptr);
+    for (u32 i = 0; i < parameters.size(); ++i) {
+      session.parameterNames.add(parameters[i].parameter->getName(1024));
+      session.parameterActive.push_back(parameters[i].active);
+      session.parameterQuantized.push_back(quantizedParameters[i]);
+      session.parameterCurves.push_back(u8(parameters[i].curve));
+    }
 
-    return tree;
+    return session;
   }
 
   return {};
 }
 
+void StateManager::getStateInformation(juce::MemoryBlock& mb) {
+  juce::MessageManagerLock lk(juce::Thread::getCurrentThread());
+
+  if (!lk.lockWasGained()) {
+    return;
+  }
+
+  // NOTE(luca): read before serialising so that a change coming in halfway through invalidates the blob
+  u64 generation = stateGeneration;
+
+  if (generation != stateCache.generation || pendingState) {
+    stateCache.data.reset();
+    getState().write(stateCache.data);
+    stateCache.generation = pendingState ? 0 : generation;
+  }
+
+  mb = stateCache.data;
+}
+
+// NOTE(luca): live clips only differ from the current document in the chunks flagged dirty, every other
+// chunk whose pointer matches the one its rows were expanded from is copied as is
+void StateManager::expandClips(f32* dst) {
+  auto& cache = stateCache;
+  const auto& current = history.current.clips;
+  constexpr u32 chunkSize = PersistentVector<Clip>::chunkSize;
+
+  u32 numParameters = u32(parameters.size());
+  u32 numChunks = PersistentVector<Clip>::getNumChunks(u32(clips.size()));
+
+  if (cache.numParameters != numParameters) {
+    cache.chunks.clear();
+    cache.numParameters = numParameters;
+  }
+
+  cache.chunks.resize(numChunks);
+  cache.rows.resize(clips.size() * numParameters);
+
+  for (u32 c = 0; c < numChunks; ++c) {
+    u32 begin = c * chunkSize;
+    u32 end = std::min(begin + chunkSize, u32(clips.size()));
+
+    bool dirty = c < history.dirtyClips.size() && history.dirtyClips[c];
+    bool clean = !dirty && c < current.chunks.size() && current.chunks[c]->size() == end - begin;
+
+    if (clean && cache.chunks[c] == current.chunks[c]) {
+      continue;
+    }
+
+    for (u32 i = begin; i < end; ++i) {
+      clips[i].expand(cache.rows.data() + size_t(i) * numParameters);
+    }
+
+    cache.chunks[c] = clean ? current.chunks[c] : nullptr;
+  }
+
+  std::copy(cache.rows.begin(), cache.rows.end(), dst);
+}
+
+void StateManager::wakeTimer() {
+  JUCE_ASSERT_MESSAGE_THREAD
+
+  if (isTimerRunning() && idleFrames >= kIdleFrameThreshold) {
+    idleFrames = 0;
+    startTimerHz(kFrameRate);
+  }
+}
+
 void StateManager::timerCallback() {
+  if (recordParameter != NONE) {
+    recorder.drain();
+  }
+
+  // NOTE(luca): values the engine wrote since the last frame
+  if (parametersView && parametersView->isVisible() && uiParameterSync.mode == UIParameterSync::UIUpdate) {
+    for (u32 i = 0; i < parameters.size(); ++i) {
+      if (uiParameterSync.updates[i]) {
+        uiParameterSync.updates[i] = false;
+        parametersView->setValue(i, uiParameterSync.values[i]);
+      }
+    }
+
+    uiParameterSync.mode = UIParameterSync::EngineUpdate;
+  }
+
+  // NOTE(luca): the audio thread only raises transportChanged when the playhead or time signature
+  // actually moved, so with the transport stopped we drop to a slow idle poll
+  bool dirty = transportChanged.exchange(false) || dragPreview.dirty;
+
+  if (!dirty) {
+    if (idleFrames < kIdleFrameThreshold && ++idleFrames == kIdleFrameThreshold) {
+      startTimerHz(kIdleFrameRate);
+    }
+
+    return;
+  }
+
+  if (idleFrames >= kIdleFrameThreshold) {
+    startTimerHz(kFrameRate);
+  }
+
+  idleFrames = 0;
+
+  if (dragPreview.dirty) {
+    commitDragPreview();
+  }
+
   TimeSignature ts { numerator.load(), denominator.load() };
 
   if (ts.numerator != grid.ts.numerator || ts.denominator != grid.ts.denominator) {
@@ -1196,22 +2588,6 @@ void StateManager::timerCallback() {
         }
       }
     }
-
-    //{
-    //  if (uiParameterSync.mode == UIParameterSync::UIUpdate) {
-    //    for (u32 i = 0; i < parameters.size(); ++i) {
-    //      auto& views = parametersView->parameterViews;
-
-    //      if (uiParameterSync.updates[i]) {
-    //        uiParameterSync.updates[i] = false; 
-    //        views[i32(i)]->dial.setValue(uiParameterSync.values[i], DONT_NOTIFY); 
-    //        views[i32(i)]->repaint();
-    //      }
-    //    }
-
-    //    uiParameterSync.mode = UIParameterSync::EngineUpdate;
-    //  }
-    //}
   }
 }
 
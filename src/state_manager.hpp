@@ -4,7 +4,13 @@
 #include <juce_data_structures/juce_data_structures.h>
 #include <juce_audio_processors/juce_audio_processors.h>
 #include "types.hpp"
+#include "session.hpp"
+#include "document.hpp"
+#include "journal.hpp"
+#include "recorder.hpp"
 #include <span>
+#include <array>
+#include <bit>
 #include <assert.h>
 
 namespace atmt {
@@ -23,38 +29,37 @@ static constexpr i32 kWidth = 600;
 static constexpr i32 kHeight = kTrackHeight + kToolBarHeight;
 
 static constexpr f32 kDefaultPathCurve = 0.5f;
+static constexpr f32 kPadLayoutRadius = 0.35f;
+static constexpr u32 kNumVariations = 8;
+static constexpr f32 kVariationDepth = 0.25f;
 static constexpr i32 kDefaultViewWidth = 600;
 static constexpr i32 kDefaultViewHeight = 600;
 
+static constexpr i32 kFrameRate = 60;
+static constexpr i32 kIdleFrameRate = 10;
+static constexpr u32 kIdleFrameThreshold = 30;
+
 static bool gShiftKeyPressed = false;
 static bool gCmdKeyPressed = false;
 static bool gOptKeyPressed = false;
 
-struct Path {
-  f32 x = 0;
-  f32 y = 0;
-  f32 c = 0.5;
-};
-
-struct Clip {
-  f32 x = 0;
-  f32 y = 0;
-  f32 c = 0.5;
-  std::vector<f32> parameters; 
-};
-
+// NOTE(luca): clips and paths merged into one list sorted by x, id indexes clips or paths depending on isClip
 struct AutomationPoint {
   f32 x = 0;
   f32 y = 0;
   f32 c = 0.5;
   u32 id = 0;
-  Clip* clip = nullptr;
-  Path* path = nullptr;
+  bool isClip = false;
 };
 
+// NOTE(luca): how a parameter moves between two clips, the engine runs one kernel per curve
+enum class Curve : u8 { linear, exponential, sCurve, step };
+static constexpr u32 kNumCurves = 4;
+
 struct Parameter {
   juce::AudioProcessorParameter* parameter = nullptr;
   bool active = true;
+  Curve curve = Curve::linear;
 };
 
 struct Selection {
@@ -68,7 +73,33 @@ struct LerpPair {
   f32 start;
   f32 end;
   bool interpolate;
-  std::vector<bool> parameters;
+  // NOTE(luca): indices of the parameters that differ between the two clips, split by curve
+  std::array<std::vector<u32>, kNumCurves> changed;
+};
+
+struct History {
+  static constexpr u32 maxSteps = 256;
+
+  Document current;
+  std::vector<Document> undo;
+  std::vector<Document> redo;
+  std::vector<bool> dirtyClips;
+  std::vector<bool> dirtyPaths;
+  bool dirtyActive = false;
+};
+
+struct DragPreview {
+  bool active = false;
+  bool dirty = false;
+};
+
+// NOTE(luca): lerp pairs follow the clips in the order of the automation points. Edits that kept the
+// points in sync only recompute the pairs next to clips marked dirty, every other pair is carried over.
+struct LerpPairsSync {
+  bool inSync = false;
+  std::vector<bool> dirty;
+  std::vector<i32> pairOf;
+  std::vector<LerpPair> next;
 };
 
 struct UIParameterSync {
@@ -81,15 +112,58 @@ struct UIParameterSync {
   std::atomic<bool> mode = EngineUpdate;
 };
 
+// NOTE(luca): hosted parameter changes can come from any thread and a preset change moves hundreds of them
+// at once, so the listener only sets a bit and the set is drained in one batch on the message thread
+struct PendingParameterChanges {
+  std::unique_ptr<std::atomic<u64>[]> words;
+  u32 numWords = 0;
+
+  void resize(u32 numParameters) {
+    numWords = (numParameters + 63) / 64;
+    words = std::make_unique<std::atomic<u64>[]>(numWords);
+  }
+
+  void set(u32 i) {
+    if ((i >> 6) < numWords) {
+      words[i >> 6].fetch_or(u64(1) << (i & 63), std::memory_order_release);
+    }
+  }
+
+  template <typename F>
+  void drain(F&& f) {
+    for (u32 w = 0; w < numWords; ++w) {
+      u64 bits = words[w].exchange(0, std::memory_order_acquire);
+
+      while (bits) {
+        f(w * 64 + u32(std::countr_zero(bits)));
+        bits &= bits - 1;
+      }
+    }
+  }
+};
+
+// NOTE(luca): some hosts ask for the state on every undo point or autosave. The last blob is handed back
+// until stateGeneration moves, and clip rows are only re-expanded for chunks that changed since.
+struct StateCache {
+  u64 generation = 0;
+  juce::MemoryBlock data;
+  u32 numParameters = 0;
+  std::vector<std::shared_ptr<const std::vector<Clip>>> chunks;
+  std::vector<f32> rows;
+};
+
 struct Plugin;
 struct Engine;
 struct Editor;
 struct TrackView;
+struct ClipView;
+struct PathView;
 struct AutomationLane;
 struct ParametersView;
 struct ToolBar;
+struct PadView;
 
-struct StateManager : juce::AudioProcessorParameter::Listener, juce::Timer {
+struct StateManager : juce::AudioProcessorParameter::Listener, juce::AudioProcessorListener, juce::ChangeListener, juce::Timer, juce::AsyncUpdater {
   juce::AudioProcessor& proc;
   Plugin* plugin = nullptr;
   Engine* engine = nullptr;
@@ -98,26 +172,49 @@ struct StateManager : juce::AudioProcessorParameter::Listener, juce::Timer {
   AutomationLane* automationView = nullptr;
   ParametersView* parametersView = nullptr;
   ToolBar* toolBarView = nullptr;
+  PadView* padView = nullptr;
+
+  // NOTE(luca): the plug-in list changed while the browser was hidden, it is reindexed when shown again
+  bool pluginIndexDirty = false;
 
   juce::String pluginID = "";
   std::atomic<bool> editMode = false;
   std::atomic<bool> discreteMode = false;
+  bool quantizeClips = false;
   std::atomic<bool> captureParameterChanges = false;
   std::atomic<bool> releaseParameterChanges = false;
   std::atomic<f32>  randomSpread = 2;
+  std::atomic<bool> padMode = false;
+  std::atomic<bool> recordMode = false;
   f32 zoom = 100;
 
   std::atomic<f32> playheadPosition = 0;
   std::atomic<f32> bpm = 120;
   std::atomic<u32> numerator = 4;
   std::atomic<u32> denominator = 4;
+  std::atomic<bool> transportChanged = false;
+  u32 idleFrames = 0;
   std::vector<Parameter> parameters;
+  std::vector<bool> quantizedParameters;
+  std::atomic<i32> lastTouchedParameter = NONE;
+  std::atomic<i32> recordParameter = NONE;
   Grid grid;
 
+  // NOTE(luca): xy pad position, exposed to the host so that it can be automated
+  juce::AudioParameterFloat* padX = nullptr;
+  juce::AudioParameterFloat* padY = nullptr;
+  std::unique_ptr<juce::ParameterAttachment> padXAttachment;
+  std::unique_ptr<juce::ParameterAttachment> padYAttachment;
+
   // NOTE(luca): track
   std::vector<Clip> clips;
+  std::shared_ptr<const std::vector<f32>> baseSnapshot;
+  std::atomic<u32> clipGeneration = 0;
   std::vector<Path> paths;
   std::vector<AutomationPoint> points;
+  std::vector<u32> clipPoints;
+  std::vector<u32> pathPoints;
+  bool pointsInSync = false;
   juce::Path automation;
   Selection selection;
   i32 selectedClipID = NONE;
@@ -125,10 +222,27 @@ struct StateManager : juce::AudioProcessorParameter::Listener, juce::Timer {
   i32 trackWidth = 0;
 
   UIParameterSync uiParameterSync;
+  PendingParameterChanges pendingParameterChanges;
+  Recorder recorder;
+  DragPreview dragPreview;
+  LerpPairsSync lerpPairsSync;
+  History history;
+  std::atomic<u64> stateGeneration = 1;
+  StateCache stateCache;
 
   std::unique_ptr<juce::AudioPluginInstance> instance;
   std::unique_ptr<juce::AudioProcessorEditor> instanceEditor;
 
+  // NOTE(luca): asynchronous loading
+  u32 loadGeneration = 0;
+  juce::String loadingPluginName;
+  std::unique_ptr<Session> pendingState;
+  juce::File recoveredJournal;
+  juce::ThreadPool loader { 1 };
+
+  // NOTE(luca): declared last so its thread stops before anything it captures goes away
+  Journal journal;
+
   StateManager(juce::AudioProcessor&);
 
   void addClip(f32, f32, f32);
@@ -155,11 +269,50 @@ struct StateManager : juce::AudioProcessorParameter::Listener, juce::Timer {
 
   i32 findAutomationPoint(f32);
   i32 findAutomationPointDenorm(f32);
+  AutomationPoint* findClipPoint(u32);
+  AutomationPoint* findPathPoint(u32);
+
+  void beginDragPreview();
+  void endDragPreview();
+  void commitDragPreview();
+  void endRemovalPreview();
+  void previewAutomationPoint(AutomationPoint*, f32, f32, f32);
+  void rebuildPoints();
+  void insertPoint(bool, u32);
+  void erasePoint(bool, u32);
+  void updatePoint(bool, u32);
+  void sortPoint(u32);
+  void reindexPoints(u32, u32);
+
+  void markClipsDirty(u32, u32);
+  void markPathsDirty(u32, u32);
+  void commitUndoStep();
+  void resetHistory();
+  void applyDocument(const Document&);
+  void undo();
+  void redo();
+  Journal::Settings getJournalSettings();
+  Journal::Meta getJournalMeta();
+  void recoverSession();
 
   void doZoom(f32, i32);
   void doScroll(f32);
   void setEditMode(bool);
   void setDiscreteMode(bool);
+  void setQuantizeClips(bool);
+
+  void setPadMode(bool);
+  void setRecordMode(bool);
+  void finishRecording();
+  void setPadPosition(f32, f32);
+  void beginPadGesture();
+  void endPadGesture();
+  void padPositionChanged();
+  void movePadPoint(u32, f32, f32);
+  void layoutPadPoints();
+  void updatePadView();
+  void updateParametersView();
+  void toggleParametersView();
 
   void setSelection(f32, f32);
   void setSelectionDenorm(f32, f32);
@@ -173,33 +326,57 @@ struct StateManager : juce::AudioProcessorParameter::Listener, juce::Timer {
   // NOTE(luca): Parameter operations
   bool shouldProcessParameter(u32);
   void randomiseParameters();
+  void generateVariations(u32);
+  void captureClip(Clip&, const f32*);
+  void updateQuantizedParameters();
   void setAllParametersActive(bool);
   void setParameterActive(u32, bool);
+  void setParameterCurve(u32, Curve);
+  void cycleLastTouchedParameterCurve();
+  void updateCurveGroups();
 
   void parameterValueChanged(i32, f32) override;
   void parameterGestureChanged(i32, bool) override;
+  void handleAsyncUpdate() override;
+  void audioProcessorParameterChanged(juce::AudioProcessor*, i32, f32) override;
+  void audioProcessorChanged(juce::AudioProcessor*, const ChangeDetails&) override;
 
   void updateTrackWidth();
   void updateLerpPairs();
+  void markLerpPairsDirty(u32);
   void updateAutomation();
+  void buildAutomationPath(juce::Path&);
   void updateAutomationView();
+  void updateAutomationViewPath(const juce::Path&);
+  void updateDragPreviewView();
+  void setClipViewBounds(ClipView*, f32, f32);
+  void setPathViewBounds(PathView*, f32, f32);
   void updateTrackView();
   void updateGrid();
   void updateTrack();
   void updateToolBarView();
+  void updateInfoView();
 
   void showDefaultView();
   void showMainView();
-  bool loadPlugin(const juce::String&);
+  void loadPlugin(const juce::String&, std::unique_ptr<Session> = {});
+  void installPlugin(std::unique_ptr<juce::AudioPluginInstance>, f64, i32);
+  void changeListenerCallback(juce::ChangeBroadcaster*) override;
 
   void registerEditor(Editor*);
   void deregisterEditor(Editor*);
 
   void init();
-  void replace(const juce::ValueTree&);
-  juce::ValueTree getState();
+  void replace(std::unique_ptr<Session>);
+  void restore(const Session&);
+  Session getState();
+  void getStateInformation(juce::MemoryBlock&);
+  void expandClips(f32*);
 
+  void wakeTimer();
   void timerCallback() override;
+
+  JUCE_DECLARE_WEAK_REFERENCEABLE(StateManager)
 };
 
 } // namespace atmt 
@@ -7,12 +7,13 @@ using File = juce::File;
 
 const File FilePath::data { File::getSpecialLocation(File::userApplicationDataDirectory).getChildFile("Automate") };
 const File FilePath::knownPluginList { data.getChildFile("KnownPluginList.txt") };
+const File FilePath::scanCache { data.getChildFile("ScanCache.xml") };
+const File FilePath::pluginListCache { data.getChildFile("KnownPluginList.bin") };
+const File FilePath::autosave { data.getChildFile("Autosave") };
 
 void FilePath::init() {
   jassert(data.hasWriteAccess());
-  jassert(knownPluginList.hasWriteAccess());
   data.createDirectory();  
-  knownPluginList.create();
 }
 
 static void loadKnownPluginList(juce::KnownPluginList& kpl) {
@@ -22,13 +23,6 @@ static void loadKnownPluginList(juce::KnownPluginList& kpl) {
   }
 }
 
-static void saveKnownPluginList(juce::KnownPluginList& kpl) {
-  auto xml = kpl.createXml();
-  if (xml) {
-    xml->writeTo(FilePath::knownPluginList);
-  }
-}
-
 inline double secondsToPpq(double bpm, double seconds) {
   // TODO(luca): this is incorrect
   return 60.0 * seconds / bpm;
@@ -58,4 +52,20 @@ inline f32 random(f32 randomSpread) {
   return v;
 }
 
+// NOTE(luca): counter based generator, every draw is a pure function of the seed and its index so a whole
+// batch can be filled in one flat loop with nothing carried from one value to the next
+inline u64 splitmix64(u64 x) {
+  x += 0x9e3779b97f4a7c15ull;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+// NOTE(luca): sum of four uniforms from one 64-bit draw, close enough to a unit normal for our purposes
+inline f32 counterNormal(u64 seed, u64 counter) {
+  u64 bits = splitmix64(seed ^ (counter * 0xd1b54a32d192ed03ull));
+  f32 sum = f32(bits & 0xffff) + f32((bits >> 16) & 0xffff) + f32((bits >> 32) & 0xffff) + f32(bits >> 48);
+  return (sum * (1.f / 65536.f) - 2.f) * 1.7320508f;
+}
+
 } // namespace atmt
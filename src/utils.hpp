@@ -38,6 +38,9 @@ struct FilePath {
   static void init();
   static const File data;
   static const File knownPluginList;
+  static const File scanCache;
+  static const File pluginListCache;
+  static const File autosave;
 };
 
 } // namespace atmt